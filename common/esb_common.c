@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include "esb_common.h"
+
+/* These are arbitrary default addresses. In end user products
+ * different addresses should be used for each set of devices.
+ */
+const uint8_t esb_common_base_addr_0[ESB_COMMON_NUM_ADDR_SETS][4] = {{0xE7, 0xE7, 0xE7, 0xE7}, {0xEE, 0xEE, 0xEE, 0xEE}};
+const uint8_t esb_common_channels[ESB_COMMON_NUM_ADDR_SETS] = {2, 4}; // channel selection per periph
+const uint8_t esb_common_base_addr_1[4] = {0xC2, 0xC2, 0xC2, 0xC2};
+const uint8_t esb_common_addr_prefix[ESB_COMMON_NUM_PIPES] = {0xE7, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8};
+
+/* 2400 + n MHz. Half of them (25, 49, 76, 80) sit in the gaps between and above Wi-Fi
+ * channels 1/6/11 (2401-2423, 2426-2448, 2451-2473 MHz). The other half (2, 14, 38, 62)
+ * lie inside Wi-Fi 1, 1, 6 and 11 on purpose, spread over the band so one interferer
+ * can't take the whole table out. The blacklist drops whichever are busy where it runs.
+ */
+const uint8_t esb_common_hop_channels[] = {ESB_COMMON_HOP_CHANNEL_LIST};
+BUILD_ASSERT(ARRAY_SIZE(esb_common_hop_channels) == ESB_COMMON_NUM_HOP_CHANNELS, "hop channel count mismatch");
+
+int esb_common_hop_index(uint8_t channel)
+{
+	for (int i = 0; i < ESB_COMMON_NUM_HOP_CHANNELS; i++)
+	{
+		if (esb_common_hop_channels[i] == channel)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef ESB_COMMON_H_
+#define ESB_COMMON_H_
+
+#include <zephyr/sys/util.h>
+#include <zephyr/types.h>
+
+/* Addressing shared by the PTX and the PRXs. Both sides have to agree on these,
+ * so they live here instead of being copied into each esb_initialize().
+ */
+#define ESB_COMMON_NUM_PIPES 8
+#define ESB_COMMON_MAX_RF_CHANNEL 100 // esb_set_rf_channel() takes 0..100 (2400..2500 MHz)
+
+// per-peripheral base address 0 + channel, used when not on the shared channel
+#define ESB_COMMON_NUM_ADDR_SETS 2
+
+extern const uint8_t esb_common_base_addr_0[ESB_COMMON_NUM_ADDR_SETS][4];
+extern const uint8_t esb_common_channels[ESB_COMMON_NUM_ADDR_SETS];
+extern const uint8_t esb_common_base_addr_1[4];
+extern const uint8_t esb_common_addr_prefix[ESB_COMMON_NUM_PIPES];
+
+// group address on the shared channel: every prx listens on it next to its own pipe, the ptx
+// sends broadcasts there without asking for an ack. not available as a node pipe then.
+#define ESB_COMMON_BCAST_PIPE 7
+
+// channel hopping on the shared channel: the channels the fleet can move between. the list
+// backs esb_common_hop_channels, as a macro so config can be checked against it at build time.
+#define ESB_COMMON_HOP_CHANNEL_LIST 2, 25, 49, 76, 80, 14, 38, 62
+#define ESB_COMMON_NUM_HOP_CHANNELS 8
+
+#define ESB_COMMON_HOP_CHANNEL_EQ(hop_ch, ch) || ((hop_ch) == (ch))
+// constant expression, true if ch is in ESB_COMMON_HOP_CHANNEL_LIST
+#define ESB_COMMON_IS_HOP_CHANNEL(ch) (0 FOR_EACH_FIXED_ARG(ESB_COMMON_HOP_CHANNEL_EQ, (), ch, ESB_COMMON_HOP_CHANNEL_LIST))
+
+extern const uint8_t esb_common_hop_channels[ESB_COMMON_NUM_HOP_CHANNELS];
+
+// index in esb_common_hop_channels, -1 if the channel isn't in the table
+int esb_common_hop_index(uint8_t channel);
+
+#endif /* ESB_COMMON_H_ */
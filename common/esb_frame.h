@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef ESB_FRAME_H_
+#define ESB_FRAME_H_
+
+#include <string.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/types.h>
+#include <esb.h>
+
+#include "esb_proto.h"
+
+/* Record framing for ESB_PROTO_DATA payloads. The body after the proto header is a run
+ * of length-prefixed application records, [len][len bytes][len][len bytes]..., packed up
+ * to CONFIG_ESB_MAX_PAYLOAD_LENGTH so many small messages share one radio exchange.
+ * A zero length record is padding and ends the payload.
+ */
+#define ESB_FRAME_REC_HDR_LEN 1
+#define ESB_FRAME_MAX_REC_LEN (ESB_PROTO_MAX_BODY_LEN - ESB_FRAME_REC_HDR_LEN)
+
+// start an empty data payload, records get appended after the header
+static inline void esb_frame_init(struct esb_payload *payload, uint8_t seq)
+{
+	struct esb_proto_hdr *hdr = (struct esb_proto_hdr *)payload->data;
+
+	hdr->type = ESB_PROTO_DATA;
+	hdr->id = seq;
+	payload->length = ESB_PROTO_HDR_LEN;
+}
+
+static inline bool esb_frame_fits(const struct esb_payload *payload, uint8_t len)
+{
+	return len > 0 && payload->length + ESB_FRAME_REC_HDR_LEN + len <= CONFIG_ESB_MAX_PAYLOAD_LENGTH;
+}
+
+// false (payload untouched) when the record doesn't fit anymore
+static inline bool esb_frame_put(struct esb_payload *payload, const uint8_t *data, uint8_t len)
+{
+	if (!esb_frame_fits(payload, len))
+	{
+		return false;
+	}
+
+	payload->data[payload->length] = len;
+	memcpy(&payload->data[payload->length + ESB_FRAME_REC_HDR_LEN], data, len);
+	payload->length += ESB_FRAME_REC_HDR_LEN + len;
+
+	return true;
+}
+
+// walk the records, start with *offset = 0. returns the next record and its length, NULL at the end
+// or on a malformed record.
+static inline const uint8_t *esb_frame_next(const struct esb_payload *payload, uint8_t *offset, uint8_t *len)
+{
+	uint16_t pos = MAX(*offset, ESB_PROTO_HDR_LEN);
+
+	if (pos + ESB_FRAME_REC_HDR_LEN > payload->length)
+	{
+		return NULL;
+	}
+
+	*len = payload->data[pos];
+	if (*len == 0 || pos + ESB_FRAME_REC_HDR_LEN + *len > payload->length)
+	{
+		return NULL;
+	}
+
+	*offset = pos + ESB_FRAME_REC_HDR_LEN + *len;
+	return &payload->data[pos + ESB_FRAME_REC_HDR_LEN];
+}
+
+#endif /* ESB_FRAME_H_ */
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef ESB_PROTO_H_
+#define ESB_PROTO_H_
+
+#include <zephyr/toolchain.h>
+#include <zephyr/types.h>
+
+/* On-air format shared by the PTX and the PRXs. Every payload, in both directions,
+ * starts with this two byte header followed by the body.
+ */
+enum esb_proto_type
+{
+	ESB_PROTO_DATA = 0x01,	 // application records packed with esb_frame.h, both directions. ptx -> prx: a repeated id is a resend
+	ESB_PROTO_TXN_REQ,		 // ptx -> prx: request, the prx prepares the response right away
+	ESB_PROTO_TXN_PICKUP,	 // ptx -> prx: sent back to back after a request to collect the response
+	ESB_PROTO_TXN_RSP,		 // prx -> ptx: response, as ack payload to the pickup
+	ESB_PROTO_PLACEHOLDER,	 // prx -> ptx: filler in the ack fifo, never meant to go on air
+	ESB_PROTO_BULK_REQ,		 // ptx -> prx: send object body[0] as bulk fragments in the following acks, from le32 offset body[1..4] if present
+	ESB_PROTO_BULK_DATA,	 // prx -> ptx: one fragment, struct esb_proto_bulk + data. total 0: no such object
+	ESB_PROTO_HOP,			 // ptx -> prx: move to channel body[0], back to the old one if not polled there soon
+	ESB_PROTO_SYNC,			 // ptx -> prx: struct esb_proto_sync, tdma schedule + timing of this poll
+	ESB_PROTO_BCAST,		 // ptx -> all prxs on ESB_COMMON_BCAST_PIPE, no ack: records like DATA, repeats share the id
+};
+
+struct esb_proto_hdr
+{
+	uint8_t type; // enum esb_proto_type
+	uint8_t id;	  // sequence number, or transaction id for ESB_PROTO_TXN_*
+} __packed;
+
+#define ESB_PROTO_HDR_LEN sizeof(struct esb_proto_hdr)
+#define ESB_PROTO_MAX_BODY_LEN (CONFIG_ESB_MAX_PAYLOAD_LENGTH - ESB_PROTO_HDR_LEN)
+
+// body of ESB_PROTO_BULK_DATA, little endian. the offset lets the ptx spot a missing fragment.
+struct esb_proto_bulk
+{
+	uint32_t total;
+	uint32_t offset;
+} __packed;
+
+#define ESB_PROTO_BULK_MAX_CHUNK (ESB_PROTO_MAX_BODY_LEN - sizeof(struct esb_proto_bulk))
+
+// body of ESB_PROTO_SYNC, little endian. the node's slot starts every cycle_us, this poll went out
+// late_us after its slot start, so the prx's next poll is due cycle_us - late_us after this one.
+struct esb_proto_sync
+{
+	uint32_t cycle_us;
+	uint32_t late_us;
+} __packed;
+
+#endif /* ESB_PROTO_H_ */
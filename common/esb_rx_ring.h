@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef ESB_RX_RING_H_
+#define ESB_RX_RING_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <esb.h>
+
+/* Single producer (esb event handler, ISR) / single consumer (rx thread) ring of esb payloads.
+ * Lock free: the producer only writes head, the consumer only writes tail, both are free
+ * running and wrap on the power of two size. The handler reads straight from the ESB FIFO
+ * into a slot, so there is no extra copy and no logging in ISR context.
+ */
+#define ESB_RX_RING_SIZE CONFIG_ESB_RX_RING_SIZE
+BUILD_ASSERT(IS_POWER_OF_TWO(ESB_RX_RING_SIZE), "CONFIG_ESB_RX_RING_SIZE must be a power of two");
+
+struct esb_rx_ring
+{
+	struct esb_payload slots[ESB_RX_RING_SIZE];
+	atomic_t head;			   // next slot the producer fills
+	atomic_t tail;			   // next slot the consumer reads
+	atomic_t overflows;		   // packets dropped because the ring was full
+	struct esb_payload scratch; // ESB FIFO is drained into this when full, overwritten by every drop
+};
+
+// producer side, ISR only
+static inline struct esb_payload *esb_rx_ring_claim(struct esb_rx_ring *ring)
+{
+	atomic_val_t head = atomic_get(&ring->head);
+
+	if ((uint32_t)head - (uint32_t)atomic_get(&ring->tail) >= ESB_RX_RING_SIZE)
+	{
+		return NULL;
+	}
+
+	return &ring->slots[head & (ESB_RX_RING_SIZE - 1)];
+}
+
+static inline void esb_rx_ring_commit(struct esb_rx_ring *ring)
+{
+	atomic_inc(&ring->head); // seq cst, the slot contents are visible before the new head
+}
+
+// empty the ESB RX FIFO into the ring. returns the newest packet read (dropped ones included), NULL if none.
+// a ring slot stays valid until the consumer releases it, so the handler can look at an ack payload right away.
+// with the ring full the packet is dropped: it only lands in the scratch slot, is counted in overflows and never
+// reaches the consumer, and the next dropped packet overwrites it. look at it before returning from the handler.
+static inline struct esb_payload *esb_rx_ring_fill(struct esb_rx_ring *ring)
+{
+	struct esb_payload *newest = NULL;
+
+	while (1)
+	{
+		struct esb_payload *slot = esb_rx_ring_claim(ring);
+
+		if (slot == NULL)
+		{
+			// keep draining so the ESB FIFO doesn't stall, but count what we lose
+			if (esb_read_rx_payload(&ring->scratch) != 0)
+			{
+				break;
+			}
+			atomic_inc(&ring->overflows);
+			newest = &ring->scratch;
+		}
+		else
+		{
+			if (esb_read_rx_payload(slot) != 0)
+			{
+				break;
+			}
+			esb_rx_ring_commit(ring);
+			newest = slot;
+		}
+	}
+
+	return newest;
+}
+
+// consumer side, one thread only. NULL when empty.
+static inline struct esb_payload *esb_rx_ring_peek(struct esb_rx_ring *ring)
+{
+	atomic_val_t tail = atomic_get(&ring->tail);
+
+	if (atomic_get(&ring->head) == tail)
+	{
+		return NULL;
+	}
+
+	return &ring->slots[tail & (ESB_RX_RING_SIZE - 1)];
+}
+
+static inline void esb_rx_ring_release(struct esb_rx_ring *ring)
+{
+	atomic_inc(&ring->tail); // slot goes back to the producer
+}
+
+#endif /* ESB_RX_RING_H_ */
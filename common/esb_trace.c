@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/timing/timing.h>
+
+#include "esb_trace.h"
+
+#if defined(CONFIG_ESB_TRACE)
+
+#define RING_SIZE CONFIG_ESB_TRACE_RING_SIZE
+
+BUILD_ASSERT(IS_POWER_OF_TWO(RING_SIZE), "CONFIG_ESB_TRACE_RING_SIZE must be a power of two");
+
+static struct esb_trace_record ring[RING_SIZE];
+static uint32_t head; // records written so far, free running
+static bool paused;
+static struct k_spinlock trace_lock; // a handful of stores, cheaper than anything lock free here
+
+void esb_trace_put(uint8_t event, uint8_t node, uint8_t len, int8_t rssi, uint16_t arg)
+{
+	uint32_t cycles = (uint32_t)timing_counter_get();
+	k_spinlock_key_t key = k_spin_lock(&trace_lock);
+
+	if (!paused)
+	{
+		struct esb_trace_record *rec = &ring[head & (RING_SIZE - 1)];
+
+		rec->cycles = sys_cpu_to_le32(cycles);
+		rec->seq = sys_cpu_to_le16((uint16_t)head);
+		rec->event = event;
+		rec->node = node;
+		rec->len = len;
+		rec->rssi = rssi;
+		rec->arg = sys_cpu_to_le16(arg);
+		head++;
+	}
+	k_spin_unlock(&trace_lock, key);
+}
+
+#if defined(CONFIG_SHELL)
+static void trace_set_paused(bool pause)
+{
+	k_spinlock_key_t key = k_spin_lock(&trace_lock);
+
+	paused = pause;
+	k_spin_unlock(&trace_lock, key);
+}
+
+static int cmd_trace_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	bool was_paused = paused;
+	char hex[sizeof(struct esb_trace_record) * 2 + 1];
+
+	// nothing gets overwritten while the shell is printing, events in the meantime are lost
+	trace_set_paused(true);
+
+	uint32_t count = MIN(head, RING_SIZE);
+
+	if (argc > 1)
+	{
+		count = MIN(count, strtoul(argv[1], NULL, 0));
+	}
+
+	// the decoder keys on these lines, keep the format
+	shell_print(sh, "trace: %u records, %u MHz", count, timing_freq_get_mhz());
+	for (uint32_t i = head - count; i != head; i++)
+	{
+		bin2hex((const uint8_t *)&ring[i & (RING_SIZE - 1)], sizeof(struct esb_trace_record), hex, sizeof(hex));
+		shell_print(sh, "trace %s", hex);
+	}
+
+	trace_set_paused(was_paused);
+	return 0;
+}
+
+static int cmd_trace_clear(const struct shell *sh, size_t argc, char **argv)
+{
+	k_spinlock_key_t key = k_spin_lock(&trace_lock);
+
+	head = 0;
+	k_spin_unlock(&trace_lock, key);
+	return 0;
+}
+
+static int cmd_trace_pause(const struct shell *sh, size_t argc, char **argv)
+{
+	trace_set_paused(true);
+	return 0;
+}
+
+static int cmd_trace_resume(const struct shell *sh, size_t argc, char **argv)
+{
+	trace_set_paused(false);
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(trace_cmds,
+							   SHELL_CMD_ARG(dump, NULL, "[last n], print the ring for tools/esb_trace_decode.py", cmd_trace_dump, 1, 1),
+							   SHELL_CMD_ARG(clear, NULL, "drop all records", cmd_trace_clear, 1, 0),
+							   SHELL_CMD_ARG(pause, NULL, "stop recording, keeps what's there", cmd_trace_pause, 1, 0),
+							   SHELL_CMD_ARG(resume, NULL, "record again", cmd_trace_resume, 1, 0),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(trace, &trace_cmds, "binary radio trace", NULL);
+#endif /* CONFIG_SHELL */
+
+#endif /* CONFIG_ESB_TRACE */
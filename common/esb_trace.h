@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef ESB_TRACE_H_
+#define ESB_TRACE_H_
+
+#include <zephyr/toolchain.h>
+#include <zephyr/types.h>
+
+/* Binary trace of the radio path, for tracing every packet at full rate. Trace points
+ * write a 12 byte record into a RAM ring (the oldest get overwritten) instead of
+ * formatting a log message, and compile to nothing without CONFIG_ESB_TRACE.
+ * "trace dump" in the shell prints the ring as hex lines, tools/esb_trace_decode.py turns
+ * a capture of that back into a timeline.
+ */
+enum esb_trace_event
+{
+	ESB_TRACE_TX_WRITE = 1, // ptx: poll handed to esb. arg = proto type
+	ESB_TRACE_TX_SUCCESS,	// ptx: poll acked, len/rssi of the ack payload (0 when empty). arg = attempts
+	ESB_TRACE_TX_FAILED,	// ptx: no ack. arg = attempts
+	ESB_TRACE_RX,			// prx: newest packet of the esb event, node = pipe. arg = proto type
+	ESB_TRACE_ACK_DONE,		// prx: the ptx got our ack payload
+	ESB_TRACE_RECORD,		// either side: application record unpacked, node = pipe. arg = its first two bytes
+	ESB_TRACE_RECOVER,		// ptx: no esb event in time, esb reinitialized
+	ESB_TRACE_BCAST,		// ptx: broadcast copy handed to esb, prx: broadcast received. arg = sequence number
+};
+
+// little endian, what the dump prints per record
+struct esb_trace_record
+{
+	uint32_t cycles; // timing api counter, low 32 bits
+	uint16_t seq;	 // record number, a gap means records were overwritten
+	uint8_t event;	 // enum esb_trace_event
+	uint8_t node;	 // ptx: node id, prx: pipe
+	uint8_t len;
+	int8_t rssi; // dBm, 0 if there was nothing received
+	uint16_t arg;
+} __packed;
+
+#if defined(CONFIG_ESB_TRACE)
+// any context, including the esb callbacks
+void esb_trace_put(uint8_t event, uint8_t node, uint8_t len, int8_t rssi, uint16_t arg);
+
+#define ESB_TRACE_POINT(event, node, len, rssi, arg) esb_trace_put(event, node, len, rssi, arg)
+#else
+#define ESB_TRACE_POINT(event, node, len, rssi, arg) \
+	do                                               \
+	{                                                \
+	} while (0)
+#endif
+
+#endif /* ESB_TRACE_H_ */
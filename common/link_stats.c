@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/timing/timing.h>
+
+#include "link_stats.h"
+
+LOG_MODULE_REGISTER(link_stats);
+
+static struct link_stats node_stats[LINK_STATS_NODES];
+static struct k_spinlock stats_lock; // updated from the esb callback, read from threads
+
+static uint8_t hist_bucket(uint32_t us)
+{
+	if (us < 8)
+	{
+		return us;
+	}
+
+	uint8_t exp = 31 - __builtin_clz(us); // >= 3
+	uint8_t sub = (us >> (exp - 2)) & 0x3;
+
+	return MIN(8 + (exp - 3) * 4 + sub, LINK_STATS_HIST_BUCKETS - 1);
+}
+
+static uint32_t hist_bucket_top(uint8_t bucket)
+{
+	if (bucket < 8)
+	{
+		return bucket;
+	}
+
+	uint8_t exp = 3 + (bucket - 8) / 4;
+	uint8_t sub = (bucket - 8) % 4;
+
+	return ((4 + sub + 1) << (exp - 2)) - 1;
+}
+
+void link_stats_tx(uint8_t node, bool success)
+{
+	if (node >= LINK_STATS_NODES)
+	{
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	if (success)
+	{
+		node_stats[node].tx_success++;
+	}
+	else
+	{
+		node_stats[node].tx_failed++;
+	}
+	k_spin_unlock(&stats_lock, key);
+}
+
+void link_stats_rx(uint8_t node, int8_t esb_rssi, uint8_t len)
+{
+	int8_t rssi = -esb_rssi; // radio reports the magnitude
+
+	if (node >= LINK_STATS_NODES)
+	{
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	node_stats[node].rx++;
+	node_stats[node].rx_bytes += len;
+	node_stats[node].rssi_last = rssi;
+	node_stats[node].rssi_sum += rssi;
+	k_spin_unlock(&stats_lock, key);
+}
+
+void link_stats_empty_ack(uint8_t node)
+{
+	if (node >= LINK_STATS_NODES)
+	{
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	node_stats[node].empty_acks++;
+	k_spin_unlock(&stats_lock, key);
+}
+
+void link_stats_latency(uint8_t node, uint64_t cycles)
+{
+	if (node >= LINK_STATS_NODES)
+	{
+		return;
+	}
+
+	uint32_t us = (uint32_t)MIN(timing_cycles_to_ns(cycles) / NSEC_PER_USEC, UINT32_MAX);
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	node_stats[node].hist[hist_bucket(us)]++;
+	node_stats[node].latency_count++;
+	node_stats[node].latency_max_us = MAX(node_stats[node].latency_max_us, us);
+	k_spin_unlock(&stats_lock, key);
+}
+
+int link_stats_get(uint8_t node, struct link_stats *stats)
+{
+	if (node >= LINK_STATS_NODES)
+	{
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	*stats = node_stats[node];
+	k_spin_unlock(&stats_lock, key);
+
+	return 0;
+}
+
+void link_stats_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	memset(node_stats, 0, sizeof(node_stats));
+	k_spin_unlock(&stats_lock, key);
+}
+
+uint32_t link_stats_percentile(const struct link_stats *stats, uint8_t percent)
+{
+	uint64_t target = ((uint64_t)stats->latency_count * percent + 99) / 100;
+	uint64_t seen = 0;
+
+	if (stats->latency_count == 0)
+	{
+		return 0;
+	}
+
+	for (uint8_t i = 0; i < LINK_STATS_HIST_BUCKETS; i++)
+	{
+		seen += stats->hist[i];
+		if (seen >= target)
+		{
+			return MIN(hist_bucket_top(i), stats->latency_max_us);
+		}
+	}
+
+	return stats->latency_max_us;
+}
+
+static bool link_stats_active(const struct link_stats *stats)
+{
+	return stats->tx_success || stats->tx_failed || stats->rx || stats->latency_count;
+}
+
+static int8_t link_stats_rssi_avg(const struct link_stats *stats)
+{
+	return stats->rx ? stats->rssi_sum / (int32_t)stats->rx : 0;
+}
+
+#if CONFIG_ESB_LINK_STATS_DUMP_INTERVAL_MS > 0
+static void link_stats_dump_fxn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(link_stats_dump_work, link_stats_dump_fxn);
+
+static void link_stats_dump_fxn(struct k_work *work)
+{
+	struct link_stats stats;
+	struct link_stats_record record = {
+		.magic = sys_cpu_to_le16(LINK_STATS_RECORD_MAGIC),
+		.version = LINK_STATS_RECORD_VERSION,
+		.uptime_ms = sys_cpu_to_le32(k_uptime_get_32()),
+	};
+
+	for (uint8_t i = 0; i < LINK_STATS_NODES; i++)
+	{
+		link_stats_get(i, &stats);
+		if (!link_stats_active(&stats))
+		{
+			continue;
+		}
+
+		record.node = i;
+		record.tx_success = sys_cpu_to_le32(stats.tx_success);
+		record.tx_failed = sys_cpu_to_le32(stats.tx_failed);
+		record.rx = sys_cpu_to_le32(stats.rx);
+		record.empty_acks = sys_cpu_to_le32(stats.empty_acks);
+		record.rssi_last = stats.rssi_last;
+		record.rssi_avg = link_stats_rssi_avg(&stats);
+		record.latency_p50_us = sys_cpu_to_le32(link_stats_percentile(&stats, 50));
+		record.latency_p99_us = sys_cpu_to_le32(link_stats_percentile(&stats, 99));
+		record.latency_max_us = sys_cpu_to_le32(stats.latency_max_us);
+		LOG_HEXDUMP_INF(&record, sizeof(record), "stats");
+	}
+
+	k_work_reschedule(&link_stats_dump_work, K_MSEC(CONFIG_ESB_LINK_STATS_DUMP_INTERVAL_MS));
+}
+
+static int link_stats_dump_init(void)
+{
+	k_work_reschedule(&link_stats_dump_work, K_MSEC(CONFIG_ESB_LINK_STATS_DUMP_INTERVAL_MS));
+	return 0;
+}
+
+SYS_INIT(link_stats_dump_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+#endif
+
+#if defined(CONFIG_SHELL)
+static int cmd_stats_show(const struct shell *sh, size_t argc, char **argv)
+{
+	struct link_stats stats;
+
+	shell_print(sh, "node  tx_ok  tx_fail     rx  empty  rssi(last/avg)  p50us  p99us  maxus");
+	for (uint8_t i = 0; i < LINK_STATS_NODES; i++)
+	{
+		link_stats_get(i, &stats);
+		if (!link_stats_active(&stats))
+		{
+			continue;
+		}
+
+		shell_print(sh, "%4u %6u %8u %6u %6u %7d/%-7d %6u %6u %6u", i, stats.tx_success, stats.tx_failed,
+					stats.rx, stats.empty_acks, stats.rssi_last, link_stats_rssi_avg(&stats),
+					link_stats_percentile(&stats, 50), link_stats_percentile(&stats, 99), stats.latency_max_us);
+	}
+
+	return 0;
+}
+
+static int cmd_stats_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	link_stats_reset();
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(stats_cmds,
+							   SHELL_CMD_ARG(show, NULL, "per node counters, rssi and latency", cmd_stats_show, 1, 0),
+							   SHELL_CMD_ARG(reset, NULL, "clear all counters", cmd_stats_reset, 1, 0),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(stats, &stats_cmds, "ESB link statistics", cmd_stats_show);
+#endif
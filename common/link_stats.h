@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef LINK_STATS_H_
+#define LINK_STATS_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+
+/* Per-node link counters + latency histogram, callable from the esb callback or threads.
+ * The PTX keeps one entry per node table slot and records poll round trips, the PRX
+ * keeps entry 0 for itself and records the time between polls.
+ * Exposed with the "stats" shell command and a periodic binary dump (LOG_HEXDUMP of
+ * struct link_stats_record, every CONFIG_ESB_LINK_STATS_DUMP_INTERVAL_MS).
+ */
+#define LINK_STATS_NODES CONFIG_ESB_LINK_STATS_NODES
+
+// latency buckets in us: 0-7 are exact, above that 4 buckets per power of two (~25% resolution)
+#define LINK_STATS_HIST_BUCKETS 64
+
+struct link_stats
+{
+	uint32_t tx_success;
+	uint32_t tx_failed;
+	uint32_t rx;		 // packets with payload
+	uint32_t rx_bytes;	 // their payload bytes, proto header included
+	uint32_t empty_acks; // ptx: acks without payload, prx: polls answered with an empty ack
+	int8_t rssi_last;	 // dBm
+	int32_t rssi_sum;
+	uint32_t latency_count;
+	uint32_t latency_max_us;
+	uint32_t hist[LINK_STATS_HIST_BUCKETS];
+};
+
+// what the periodic dump sends per node, little endian
+#define LINK_STATS_RECORD_MAGIC 0x5354 // "ST"
+#define LINK_STATS_RECORD_VERSION 1
+
+struct link_stats_record
+{
+	uint16_t magic;
+	uint8_t version;
+	uint8_t node;
+	uint32_t uptime_ms;
+	uint32_t tx_success;
+	uint32_t tx_failed;
+	uint32_t rx;
+	uint32_t empty_acks;
+	int8_t rssi_last;
+	int8_t rssi_avg;
+	uint16_t reserved;
+	uint32_t latency_p50_us;
+	uint32_t latency_p99_us;
+	uint32_t latency_max_us;
+} __packed;
+
+void link_stats_tx(uint8_t node, bool success);
+void link_stats_rx(uint8_t node, int8_t esb_rssi, uint8_t len); // esb_payload.rssi, RSSISAMPLE magnitude (60 = -60 dBm)
+void link_stats_empty_ack(uint8_t node);
+void link_stats_latency(uint8_t node, uint64_t cycles); // timing api cycles
+
+// snapshot of one node, -EINVAL for a bad index
+int link_stats_get(uint8_t node, struct link_stats *stats);
+void link_stats_reset(void);
+
+// us, upper edge of the bucket the percentile falls in. 0 with no samples.
+uint32_t link_stats_percentile(const struct link_stats *stats, uint8_t percent);
+
+#endif /* LINK_STATS_H_ */
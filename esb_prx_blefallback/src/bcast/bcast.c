@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+
+#include "bcast.h"
+
+LOG_MODULE_REGISTER(bcast);
+
+static K_MUTEX_DEFINE(stats_lock); // rx thread updates, shell reads
+static bool seen;
+static uint8_t last_seq;
+static struct bcast_stats stats;
+
+bool bcast_accept(uint8_t seq)
+{
+	bool accept = !seen || seq != last_seq;
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
+	if (!accept)
+	{
+		stats.duplicates++;
+	}
+	else
+	{
+		if (seen)
+		{
+			stats.missed += (uint8_t)(seq - last_seq - 1);
+		}
+		stats.accepted++;
+		seen = true;
+		last_seq = seq;
+	}
+	k_mutex_unlock(&stats_lock);
+
+	return accept;
+}
+
+void bcast_stats_get(struct bcast_stats *out)
+{
+	k_mutex_lock(&stats_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&stats_lock);
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_bcast(const struct shell *sh, size_t argc, char **argv)
+{
+	struct bcast_stats s;
+
+	bcast_stats_get(&s);
+	shell_print(sh, "broadcasts: %u accepted, %u duplicates, %u missed", s.accepted, s.duplicates, s.missed);
+	return 0;
+}
+
+SHELL_CMD_REGISTER(bcast, NULL, "broadcast counters", cmd_bcast);
+#endif
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef BCAST_H_
+#define BCAST_H_
+
+#include <zephyr/types.h>
+
+/* PRX side of the PTX broadcasts (ESB_PROTO_BCAST on ESB_COMMON_BCAST_PIPE). The PTX sends
+ * each one several times with the same sequence number, only the first copy is delivered.
+ */
+
+struct bcast_stats
+{
+	uint32_t accepted;
+	uint32_t duplicates; // repeats of a broadcast we already had
+	uint32_t missed;	 // gaps in the sequence, every copy lost
+};
+
+// rx thread: true if the broadcast with this sequence number is new
+bool bcast_accept(uint8_t seq);
+
+void bcast_stats_get(struct bcast_stats *stats);
+
+#endif /* BCAST_H_ */
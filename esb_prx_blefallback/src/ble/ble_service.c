@@ -14,6 +14,8 @@
 LOG_MODULE_REGISTER(ble_service);
 
 static bool app_button_state;
+static volatile bool app_connected;
+static struct bt_conn *current_conn; // for app_bt_adv_stop() to drop it
 
 static const struct bt_data ad[] = {
     BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
@@ -24,6 +26,46 @@ static const struct bt_data sd[] = {
     BT_DATA_BYTES(BT_DATA_UUID128_ALL, BT_UUID_LBS_VAL),
 };
 
+static void mtu_exchange_cb(struct bt_conn *conn, uint8_t att_err, struct bt_gatt_exchange_params *params)
+{
+    LOG_INF("MTU exchange %s, MTU %u\n", att_err ? "failed" : "done", bt_gatt_get_mtu(conn));
+}
+
+static struct bt_gatt_exchange_params mtu_exchange_params = {
+    .func = mtu_exchange_cb,
+};
+
+// ask for everything the data service needs to stream, the central gets the final say
+static void request_throughput_params(struct bt_conn *conn)
+{
+    int err;
+
+    err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+    if (err)
+    {
+        LOG_INF("PHY update request failed (err %d)\n", err);
+    }
+
+    err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    if (err)
+    {
+        LOG_INF("Data length update request failed (err %d)\n", err);
+    }
+
+    err = bt_gatt_exchange_mtu(conn, &mtu_exchange_params);
+    if (err)
+    {
+        LOG_INF("MTU exchange failed (err %d)\n", err);
+    }
+
+    err = bt_conn_le_param_update(conn, BT_LE_CONN_PARAM(CONFIG_ESB_PRX_BLE_CONN_INTERVAL,
+                                                         CONFIG_ESB_PRX_BLE_CONN_INTERVAL, 0, 400));
+    if (err)
+    {
+        LOG_INF("Connection parameter update request failed (err %d)\n", err);
+    }
+}
+
 static void connected(struct bt_conn *conn, uint8_t err)
 {
     if (err)
@@ -34,16 +76,41 @@ static void connected(struct bt_conn *conn, uint8_t err)
 
     LOG_INF("Connected\n");
 
+    app_connected = true;
+    current_conn = bt_conn_ref(conn);
     dk_set_led_on(CON_STATUS_LED);
+
+    request_throughput_params(conn);
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason)
 {
     LOG_INF("Disconnected (reason %u)\n", reason);
 
+    app_connected = false;
+    if (current_conn)
+    {
+        bt_conn_unref(current_conn);
+        current_conn = NULL;
+    }
     dk_set_led_off(CON_STATUS_LED);
 }
 
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+    LOG_INF("Connection interval %u us, latency %u, timeout %u ms\n", interval * 1250, latency, timeout * 10);
+}
+
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    LOG_INF("PHY tx %u rx %u\n", param->tx_phy, param->rx_phy);
+}
+
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+    LOG_INF("Data length tx %u bytes, rx %u bytes\n", info->tx_max_len, info->rx_max_len);
+}
+
 #ifdef CONFIG_BT_LBS_SECURITY_ENABLED
 static void security_changed(struct bt_conn *conn, bt_security_t level,
                              enum bt_security_err err)
@@ -67,6 +134,9 @@ static void security_changed(struct bt_conn *conn, bt_security_t level,
 BT_CONN_CB_DEFINE(conn_callbacks) = {
     .connected = connected,
     .disconnected = disconnected,
+    .le_param_updated = le_param_updated,
+    .le_phy_updated = le_phy_updated,
+    .le_data_len_updated = le_data_len_updated,
 #ifdef CONFIG_BT_LBS_SECURITY_ENABLED
     .security_changed = security_changed,
 #endif
@@ -248,3 +318,40 @@ int app_bt_restart(void)
 
     return 0;
 }
+
+bool app_bt_connected(void)
+{
+    return app_connected;
+}
+
+int app_bt_adv_start(void)
+{
+    int err = bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+
+    if (err && err != -EALREADY)
+    {
+        LOG_INF("Advertising failed to start (err %d)\n", err);
+        return err;
+    }
+
+    return 0;
+}
+
+int app_bt_adv_stop(void)
+{
+    int err = bt_le_adv_stop();
+
+    if (err)
+    {
+        LOG_INF("Advertising failed to stop (err %d)\n", err);
+        return err;
+    }
+
+    // the link goes down in the background, the radio time it still takes is arbitrated by mpsl
+    if (current_conn)
+    {
+        bt_conn_disconnect(current_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+    }
+
+    return 0;
+}
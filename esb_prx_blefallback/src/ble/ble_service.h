@@ -15,5 +15,10 @@
 
 int app_bt_init(void);
 int app_bt_restart(void);
+bool app_bt_connected(void);
+
+// warm swap: the host stays enabled, only advertising (and any connection) comes and goes
+int app_bt_adv_start(void);
+int app_bt_adv_stop(void);
 
 #endif /* BLE_SERVICE_H_ */
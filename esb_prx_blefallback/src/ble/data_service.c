@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <string.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/l2cap.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/logging/log.h>
+
+#include "data_service.h"
+#include "esb_frame.h"
+#include "esb_proto.h"
+
+LOG_MODULE_REGISTER(data_service);
+
+#define NOTIFY_MAX_LEN (BT_L2CAP_TX_MTU - 3) // ATT header
+#define NOTIFY_MIN_LEN (23 - 3)              // default ATT_MTU, until the exchange
+#define NOTIFY_MAX_AGE_MS 20                 // send a part filled notification once its oldest record is this old
+
+static struct bt_uuid_128 data_svc_uuid = BT_UUID_INIT_128(BT_UUID_DATA_SVC_VAL);
+static struct bt_uuid_128 records_uuid = BT_UUID_INIT_128(BT_UUID_DATA_SVC_RECORDS_VAL);
+
+static volatile bool notify_enabled;
+static volatile uint16_t notify_len_max = NOTIFY_MIN_LEN; // follows the MTU exchange
+
+static K_MUTEX_DEFINE(notify_lock);
+static uint8_t notify_buf[NOTIFY_MAX_LEN];
+static uint16_t notify_len;
+static uint8_t notify_records;
+static uint8_t notify_seq;
+static int64_t notify_first_ms; // uptime of the oldest queued record
+
+static struct data_service_stats totals;
+
+static void flush_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(flush_work, flush_work_handler); // sends a part filled one that got old
+
+static void records_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    notify_enabled = (value == BT_GATT_CCC_NOTIFY);
+    if (!notify_enabled)
+    {
+        // drop the part filled one, the MTU stays: it isn't exchanged again on this link
+        k_mutex_lock(&notify_lock, K_FOREVER);
+        notify_len = 0;
+        k_mutex_unlock(&notify_lock);
+    }
+    LOG_INF("Record notifications %s", notify_enabled ? "on" : "off");
+}
+
+BT_GATT_SERVICE_DEFINE(data_svc,
+                       BT_GATT_PRIMARY_SERVICE(&data_svc_uuid),
+                       BT_GATT_CHARACTERISTIC(&records_uuid.uuid, BT_GATT_CHRC_NOTIFY, BT_GATT_PERM_NONE, NULL, NULL,
+                                              NULL),
+                       BT_GATT_CCC(records_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE));
+
+static void mtu_updated(struct bt_conn *conn, uint16_t tx, uint16_t rx)
+{
+    notify_len_max = MIN(tx - 3, NOTIFY_MAX_LEN);
+    LOG_INF("MTU %u, %u bytes per notification", tx, notify_len_max);
+}
+
+static struct bt_gatt_cb gatt_callbacks = {
+    .att_mtu_updated = mtu_updated,
+};
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    // next client starts over with the default MTU
+    k_mutex_lock(&notify_lock, K_FOREVER);
+    notify_len = 0;
+    notify_len_max = NOTIFY_MIN_LEN;
+    k_mutex_unlock(&notify_lock);
+}
+
+BT_CONN_CB_DEFINE(data_service_conn_callbacks) = {
+    .disconnected = disconnected,
+};
+
+static void notify_start(void)
+{
+    struct esb_proto_hdr *hdr = (struct esb_proto_hdr *)notify_buf;
+
+    hdr->type = ESB_PROTO_DATA;
+    hdr->id = notify_seq;
+    notify_len = ESB_PROTO_HDR_LEN;
+    notify_records = 0;
+}
+
+// notify_lock held
+static int notify_send(void)
+{
+    int err = 0;
+
+    if (notify_records == 0)
+    {
+        return 0;
+    }
+
+    // characteristic value is attrs[2], after the service and the characteristic declaration
+    err = bt_gatt_notify(NULL, &data_svc.attrs[2], notify_buf, notify_len);
+    if (err)
+    {
+        totals.dropped += notify_records;
+    }
+    else
+    {
+        totals.notifications++;
+        totals.bytes += notify_len;
+        totals.records += notify_records;
+    }
+
+    notify_seq++;
+    notify_start();
+    return err;
+}
+
+bool data_service_subscribed(void)
+{
+    return notify_enabled;
+}
+
+int data_service_put(const uint8_t *data, uint8_t len)
+{
+    int err = 0;
+
+    if (len == 0 || len > ESB_FRAME_MAX_REC_LEN)
+    {
+        return -EINVAL;
+    }
+
+    if (!notify_enabled)
+    {
+        return -ENOTCONN;
+    }
+
+    k_mutex_lock(&notify_lock, K_FOREVER);
+    if (notify_len == 0)
+    {
+        notify_start();
+    }
+
+    if (notify_len + ESB_FRAME_REC_HDR_LEN + len > notify_len_max)
+    {
+        err = notify_send();
+    }
+
+    if (notify_len + ESB_FRAME_REC_HDR_LEN + len <= notify_len_max)
+    {
+        if (notify_records == 0)
+        {
+            notify_first_ms = k_uptime_get();
+            // no later put may come to send it, at a low record rate
+            k_work_schedule(&flush_work, K_MSEC(NOTIFY_MAX_AGE_MS));
+        }
+        notify_buf[notify_len] = len;
+        memcpy(&notify_buf[notify_len + ESB_FRAME_REC_HDR_LEN], data, len);
+        notify_len += ESB_FRAME_REC_HDR_LEN + len;
+        notify_records++;
+    }
+    else
+    {
+        totals.dropped++; // record bigger than what the peer's MTU allows
+    }
+
+    if (notify_records && k_uptime_get() - notify_first_ms >= NOTIFY_MAX_AGE_MS)
+    {
+        err = notify_send();
+    }
+    k_mutex_unlock(&notify_lock);
+
+    return err;
+}
+
+static void flush_work_handler(struct k_work *work)
+{
+    k_mutex_lock(&notify_lock, K_FOREVER);
+    if (notify_enabled && notify_records)
+    {
+        int64_t age = k_uptime_get() - notify_first_ms;
+
+        if (age >= NOTIFY_MAX_AGE_MS)
+        {
+            (void)notify_send();
+        }
+        else
+        {
+            // sent and refilled since this was scheduled, wait for the new oldest record
+            k_work_schedule(&flush_work, K_MSEC(NOTIFY_MAX_AGE_MS - age));
+        }
+    }
+    k_mutex_unlock(&notify_lock);
+}
+
+int data_service_flush(void)
+{
+    k_mutex_lock(&notify_lock, K_FOREVER);
+    int err = notify_enabled ? notify_send() : 0;
+    k_mutex_unlock(&notify_lock);
+
+    return err;
+}
+
+void data_service_stats_get(struct data_service_stats *stats)
+{
+    k_mutex_lock(&notify_lock, K_FOREVER);
+    *stats = totals;
+    memset(&totals, 0, sizeof(totals));
+    k_mutex_unlock(&notify_lock);
+}
+
+static int data_service_init(void)
+{
+    bt_gatt_cb_register(&gatt_callbacks);
+    return 0;
+}
+
+SYS_INIT(data_service_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef DATA_SERVICE_H_
+#define DATA_SERVICE_H_
+
+#include <zephyr/types.h>
+
+/* GATT data service for the BLE fallback. Application records are packed into
+ * notifications with the same layout as an ESB_PROTO_DATA payload (esb_proto header +
+ * length-prefixed records, see esb_frame.h), up to ATT_MTU - 3 bytes each, so the host
+ * decodes both links the same way.
+ */
+#define BT_UUID_DATA_SVC_VAL BT_UUID_128_ENCODE(0x8e7f1a20, 0x4b9a, 0x4c2d, 0x9f0e, 0x5d3b2a1c0e01)
+#define BT_UUID_DATA_SVC_RECORDS_VAL BT_UUID_128_ENCODE(0x8e7f1a20, 0x4b9a, 0x4c2d, 0x9f0e, 0x5d3b2a1c0e02)
+
+struct data_service_stats
+{
+    uint32_t records;
+    uint32_t notifications;
+    uint32_t bytes;   // notification payload, headers included
+    uint32_t dropped; // records lost to a failed notification
+};
+
+// true while a client has notifications enabled
+bool data_service_subscribed(void);
+
+// thread context, may block for a tx buffer. queues the record, sends once a notification is full or
+// its oldest record is 20 ms old (from the system workqueue if no put comes by then).
+int data_service_put(const uint8_t *data, uint8_t len);
+// send what is queued, bounds the data age at a low record rate
+int data_service_flush(void);
+
+// copy + clear
+void data_service_stats_get(struct data_service_stats *stats);
+
+#endif /* DATA_SERVICE_H_ */
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <zephyr/sys/byteorder.h>
+
+#include "esb_proto.h"
+#include "bulk.h"
+#include "../uplink/uplink.h"
+
+static bulk_source_t bulk_source;
+
+void bulk_set_source(bulk_source_t source)
+{
+	bulk_source = source;
+}
+
+void bulk_on_rx(const struct esb_payload *rx)
+{
+	const struct esb_proto_hdr *hdr = (const struct esb_proto_hdr *)rx->data;
+	const uint8_t *data;
+	int len = -ENOENT;
+
+	if (rx->length < ESB_PROTO_HDR_LEN + 1 || hdr->type != ESB_PROTO_BULK_REQ)
+	{
+		return;
+	}
+
+	// a ptx that lost a fragment asks again from where it got to
+	uint32_t offset = rx->length >= ESB_PROTO_HDR_LEN + 1 + sizeof(uint32_t)
+						  ? sys_get_le32(&rx->data[ESB_PROTO_HDR_LEN + 1])
+						  : 0;
+
+	if (bulk_source)
+	{
+		len = bulk_source(rx->data[ESB_PROTO_HDR_LEN], &data);
+	}
+	if (len > 0)
+	{
+		(void)uplink_bulk_start(data, len, offset);
+		return;
+	}
+
+	// nothing to send, a zero total tells the ptx right away instead of it polling until its timeout
+	const struct esb_proto_bulk none = {0};
+
+	(void)uplink_respond(ESB_PROTO_BULK_DATA, 0, (const uint8_t *)&none, sizeof(none));
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef BULK_H_
+#define BULK_H_
+
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* PRX side of bulk transfers. A ESB_PROTO_BULK_REQ from the PTX asks for an object, the
+ * source handler hands over its bytes and they go out as fragments in the ack payloads of
+ * the PTX's following polls (which it sends back to back while the transfer runs). A
+ * request with an offset restarts the fragments from there. An object the source doesn't
+ * have (or no source at all) gets a single fragment with a zero total.
+ */
+
+// esb irq context. point *data at the object (it must stay valid), return its length or < 0.
+typedef int (*bulk_source_t)(uint8_t object, const uint8_t **data);
+
+void bulk_set_source(bulk_source_t source);
+
+// esb irq context, call with every received packet
+void bulk_on_rx(const struct esb_payload *rx);
+
+#endif /* BULK_H_ */
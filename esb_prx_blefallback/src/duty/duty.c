@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <stdlib.h>
+#include <esb.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "duty.h"
+
+LOG_MODULE_REGISTER(duty);
+
+#define GUARD_US CONFIG_ESB_PRX_DUTY_GUARD_US
+#define WINDOW_US CONFIG_ESB_PRX_DUTY_WINDOW_US
+#define HOLD_US CONFIG_ESB_PRX_DUTY_HOLD_US
+#define LOCK_AFTER 4   // polls agreeing on the period before the receiver starts sleeping
+#define UNLOCK_AFTER 4 // empty windows in a row before it listens continuously again
+
+enum duty_state
+{
+	DUTY_OFF,	   // esb not running
+	DUTY_LEARNING, // receiving continuously, measuring the poll period
+	DUTY_HOLD,	   // polled, receiver stays on for the ack and follow ups
+	DUTY_SLEEP,	   // receiver off until the next window
+	DUTY_LISTEN,   // window open, waiting for the poll
+};
+
+static struct k_spinlock duty_lock; // esb irq, timer irq and the timeslot swi all get here
+static enum duty_state state;
+static int64_t period;	 // ticks, estimate
+static int64_t last_poll; // ticks, -1 none yet
+static int64_t expected; // ticks, next poll due
+static uint8_t agreeing;
+static uint8_t misses;
+
+// radio on time, ticks
+static bool rx_on;
+static int64_t on_since;
+static int64_t on_ticks;
+static int64_t stats_since;
+static uint32_t windows_missed;
+
+static void duty_timer_fxn(struct k_timer *timer);
+static K_TIMER_DEFINE(duty_timer, duty_timer_fxn, NULL);
+
+// duty_lock held
+static void rx_set(bool on)
+{
+	int64_t now = k_uptime_ticks();
+
+	if (on && !rx_on)
+	{
+		esb_start_rx();
+		on_since = now;
+	}
+	else if (!on && rx_on)
+	{
+		esb_stop_rx();
+		on_ticks += now - on_since;
+	}
+	rx_on = on;
+}
+
+// duty_lock held, poll in the learning state
+static void learn(int64_t interval)
+{
+	int64_t tolerance = k_us_to_ticks_ceil64(GUARD_US) / 2;
+	int64_t min_period = 2 * k_us_to_ticks_ceil64(GUARD_US + WINDOW_US + HOLD_US);
+
+	if (period > 0 && llabs(interval - period) <= tolerance)
+	{
+		period = (3 * period + interval) / 4;
+		agreeing++;
+	}
+	else
+	{
+		period = interval;
+		agreeing = 0;
+	}
+
+	if (agreeing >= LOCK_AFTER && period >= min_period)
+	{
+		misses = 0;
+		state = DUTY_HOLD;
+		LOG_DBG("locked on a %u us poll period", k_ticks_to_us_near32(period));
+	}
+}
+
+// duty_lock held, poll inside a window. bursts (transactions, bulk) come in under a period and don't count.
+// true for a scheduled poll, the one the next window is anchored on.
+static bool track(int64_t interval)
+{
+	int64_t n = (interval + period / 2) / period;
+
+	misses = 0;
+	if (n < 1)
+	{
+		return false;
+	}
+	period += (interval - n * period) / (4 * n); // follow clock drift between the two ends
+	return true;
+}
+
+void duty_on_poll(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&duty_lock);
+	int64_t now = k_uptime_ticks();
+	int64_t interval = last_poll < 0 ? -1 : now - last_poll;
+	bool scheduled = true;
+
+	if (state == DUTY_OFF || interval < 0)
+	{
+		last_poll = now;
+		k_spin_unlock(&duty_lock, key);
+		return;
+	}
+
+	if (state == DUTY_LEARNING)
+	{
+		learn(interval);
+	}
+	else
+	{
+		scheduled = track(interval);
+		state = DUTY_HOLD;
+	}
+
+	if (scheduled)
+	{
+		// burst follow-ups neither move the schedule nor shorten the next interval
+		last_poll = now;
+	}
+
+	if (state == DUTY_HOLD)
+	{
+		rx_set(true); // already on, unless the poll beat the timer to the window
+		if (scheduled)
+		{
+			expected = now + period;
+		}
+		k_timer_start(&duty_timer, K_USEC(HOLD_US), K_NO_WAIT);
+	}
+	k_spin_unlock(&duty_lock, key);
+}
+
+static void duty_timer_fxn(struct k_timer *timer)
+{
+	k_spinlock_key_t key = k_spin_lock(&duty_lock);
+
+	switch (state)
+	{
+	case DUTY_HOLD:
+		rx_set(false);
+		state = DUTY_SLEEP;
+		k_timer_start(&duty_timer, K_TIMEOUT_ABS_TICKS(expected - k_us_to_ticks_ceil64(GUARD_US)), K_NO_WAIT);
+		break;
+
+	case DUTY_SLEEP:
+		rx_set(true);
+		state = DUTY_LISTEN;
+		k_timer_start(&duty_timer, K_TIMEOUT_ABS_TICKS(expected + k_us_to_ticks_ceil64(WINDOW_US)), K_NO_WAIT);
+		break;
+
+	case DUTY_LISTEN:
+		windows_missed++;
+		if (++misses >= UNLOCK_AFTER)
+		{
+			// lost the schedule (ptx stopped, changed its rate), learn it again with the receiver on
+			state = DUTY_LEARNING;
+			agreeing = 0;
+			break;
+		}
+		rx_set(false);
+		expected += period;
+		state = DUTY_SLEEP;
+		k_timer_start(&duty_timer, K_TIMEOUT_ABS_TICKS(expected - k_us_to_ticks_ceil64(GUARD_US)), K_NO_WAIT);
+		break;
+
+	default:
+		break;
+	}
+	k_spin_unlock(&duty_lock, key);
+}
+
+void duty_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&duty_lock);
+
+	k_timer_stop(&duty_timer);
+	state = DUTY_LEARNING;
+	period = 0;
+	last_poll = -1;
+	agreeing = 0;
+	misses = 0;
+	if (!rx_on)
+	{
+		on_since = k_uptime_ticks(); // the caller starts receiving right after
+	}
+	rx_on = true;
+	k_spin_unlock(&duty_lock, key);
+}
+
+void duty_stop(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&duty_lock);
+
+	k_timer_stop(&duty_timer);
+	state = DUTY_OFF;
+	if (rx_on)
+	{
+		on_ticks += k_uptime_ticks() - on_since;
+		rx_on = false;
+	}
+	k_spin_unlock(&duty_lock, key);
+}
+
+bool duty_sleeping(void)
+{
+	return state == DUTY_SLEEP;
+}
+
+void duty_stats_get(struct duty_stats *stats)
+{
+	k_spinlock_key_t key = k_spin_lock(&duty_lock);
+	int64_t now = k_uptime_ticks();
+	int64_t on = on_ticks + (rx_on ? now - on_since : 0);
+	int64_t elapsed = MAX(now - stats_since, 1);
+	bool locked = state == DUTY_HOLD || state == DUTY_SLEEP || state == DUTY_LISTEN;
+
+	stats->locked = locked;
+	stats->period_us = locked ? k_ticks_to_us_near32(period) : 0;
+	stats->on_permille = (uint32_t)(on * 1000 / elapsed);
+	stats->on_ms_per_hour = (uint32_t)(on * 3600 * MSEC_PER_SEC / elapsed);
+	stats->windows_missed = windows_missed;
+
+	on_ticks = 0;
+	on_since = now;
+	stats_since = now;
+	windows_missed = 0;
+	k_spin_unlock(&duty_lock, key);
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef DUTY_H_
+#define DUTY_H_
+
+#include <zephyr/types.h>
+
+/* Duty cycled receiver. The PRX learns its poll period from the time between polls, once
+ * a few in a row agree it only receives from CONFIG_ESB_PRX_DUTY_GUARD_US before the next
+ * expected poll to CONFIG_ESB_PRX_DUTY_WINDOW_US after it, and CONFIG_ESB_PRX_DUTY_HOLD_US
+ * after each poll for the ack and anything the PTX sends right behind it. Every poll
+ * re-anchors the schedule. A few empty windows in a row and it receives continuously
+ * again until it has learned the period anew. Polls faster than the windows add up to
+ * aren't worth sleeping between, those keep the receiver on.
+ */
+
+struct duty_stats
+{
+	bool locked;
+	uint32_t period_us;		  // learned, 0 while learning
+	uint32_t on_permille;	  // radio receiving, since the last call
+	uint32_t on_ms_per_hour;  // the same, scaled to an hour
+	uint32_t windows_missed;  // since the last call
+};
+
+// esb_initialize(): new esb session, receiver on, learning from scratch
+void duty_reset(void);
+
+// before esb goes away (disable, timeslot closed), no more esb calls from here
+void duty_stop(void);
+
+// esb irq context, a poll to our pipe
+void duty_on_poll(void);
+
+// true while the receiver is off between windows, esb is idle and can be reconfigured
+bool duty_sleeping(void);
+
+void duty_stats_get(struct duty_stats *stats);
+
+#endif /* DUTY_H_ */
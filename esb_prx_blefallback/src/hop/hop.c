@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <zephyr/logging/log.h>
+
+#include "esb_common.h"
+#include "esb_proto.h"
+#include "hop.h"
+#include "../duty/duty.h"
+#include "../supervisor/supervisor.h"
+
+LOG_MODULE_REGISTER(hop);
+
+#define HOP_AFTER_ACK_MS 1 // the ack to the hop frame is still on air when the rx event fires
+
+static volatile uint8_t channel = CONFIG_ESB_PRX_SHARED_RF_CHANNEL;
+static volatile uint8_t polled_channel = CONFIG_ESB_PRX_SHARED_RF_CHANNEL; // last one a poll came in on
+static uint8_t prev_channel;
+static volatile uint8_t hop_to;
+static volatile bool confirm_pending;
+static volatile uint32_t last_poll_ms; // k_uptime_get_32()
+static uint8_t scan_index;
+
+static void hop_work_fxn(struct k_work *work);
+static void confirm_work_fxn(struct k_work *work);
+static void scan_work_fxn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(hop_work, hop_work_fxn);
+static K_WORK_DELAYABLE_DEFINE(confirm_work, confirm_work_fxn);
+static K_WORK_DELAYABLE_DEFINE(scan_work, scan_work_fxn);
+
+// esb_set_rf_channel() only works while esb is idle. when esb isn't receiving (BLE mode,
+// between timeslots) the channel is picked up by the next esb_initialize().
+static void apply_channel(uint8_t ch)
+{
+	unsigned int key = irq_lock();
+
+	channel = ch;
+	if (esb_stop_rx() == 0)
+	{
+		esb_set_rf_channel(ch);
+		esb_start_rx();
+	}
+#if defined(CONFIG_ESB_PRX_DUTY_CYCLE)
+	else if (duty_sleeping())
+	{
+		esb_set_rf_channel(ch); // receiver off between polls, the next window opens on the new channel
+	}
+#endif
+	irq_unlock(key);
+}
+
+static void hop_work_fxn(struct k_work *work)
+{
+	prev_channel = channel;
+	confirm_pending = true;
+	apply_channel(hop_to);
+	k_work_reschedule(&confirm_work, K_MSEC(CONFIG_ESB_PRX_HOP_CONFIRM_MS));
+	LOG_DBG("Hop %u -> %u", prev_channel, hop_to);
+}
+
+static void confirm_work_fxn(struct k_work *work)
+{
+	if (confirm_pending)
+	{
+		confirm_pending = false;
+		apply_channel(prev_channel);
+		LOG_WRN("Not polled on channel %u, back on %u", hop_to, prev_channel);
+	}
+}
+
+static void scan_work_fxn(struct k_work *work)
+{
+#if defined(CONFIG_ESB_PRX_LINK_SUPERVISOR)
+	// BLE mode: esb only listens during probes, those pick their channel with hop_probe_missed()
+	bool scanning = supervisor_mode() == LINK_MODE_ESB;
+#else
+	bool scanning = true;
+#endif
+
+	if (scanning && k_uptime_get_32() - last_poll_ms >= CONFIG_ESB_PRX_HOP_SCAN_AFTER_MS)
+	{
+		scan_index = (scan_index + 1) % ESB_COMMON_NUM_HOP_CHANNELS;
+		apply_channel(esb_common_hop_channels[scan_index]);
+		LOG_DBG("Lost the PTX, listening on channel %u", channel);
+	}
+
+	k_work_reschedule(&scan_work, K_MSEC(CONFIG_ESB_PRX_HOP_SCAN_DWELL_MS));
+}
+
+uint8_t hop_channel(void)
+{
+	return channel;
+}
+
+void hop_probe_missed(void)
+{
+	uint8_t next = polled_channel;
+
+	// every other probe goes back to where the ptx was last heard, the ones in between walk the
+	// hop channels in case the fleet moved while we were away
+	if (channel == polled_channel)
+	{
+		scan_index = (scan_index + 1) % ESB_COMMON_NUM_HOP_CHANNELS;
+		if (esb_common_hop_channels[scan_index] == polled_channel)
+		{
+			scan_index = (scan_index + 1) % ESB_COMMON_NUM_HOP_CHANNELS;
+		}
+		next = esb_common_hop_channels[scan_index];
+	}
+	apply_channel(next);
+	LOG_DBG("Next probe on channel %u", next);
+}
+
+void hop_on_rx(const struct esb_payload *rx)
+{
+	const struct esb_proto_hdr *hdr = (const struct esb_proto_hdr *)rx->data;
+
+	last_poll_ms = k_uptime_get_32();
+	polled_channel = channel;
+	confirm_pending = false; // any poll on the new channel confirms the hop
+
+	if (rx->length < ESB_PROTO_HDR_LEN + 1 || hdr->type != ESB_PROTO_HOP)
+	{
+		return;
+	}
+
+	uint8_t ch = rx->data[ESB_PROTO_HDR_LEN];
+	if (ch != channel && ch <= ESB_COMMON_MAX_RF_CHANNEL)
+	{
+		hop_to = ch;
+		k_work_reschedule(&hop_work, K_MSEC(HOP_AFTER_ACK_MS));
+	}
+}
+
+static int hop_init(void)
+{
+	int index = esb_common_hop_index(channel);
+
+	scan_index = MAX(index, 0);
+	last_poll_ms = k_uptime_get_32();
+	k_work_reschedule(&scan_work, K_MSEC(CONFIG_ESB_PRX_HOP_SCAN_DWELL_MS));
+	return 0;
+}
+
+SYS_INIT(hop_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
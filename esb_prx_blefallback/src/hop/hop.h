@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef HOP_H_
+#define HOP_H_
+
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* PRX side of the channel hopping, the PTX decides where the fleet goes. An ESB_PROTO_HOP
+ * moves us right after its ack went out. If no poll arrives on the new channel within
+ * CONFIG_ESB_PRX_HOP_CONFIRM_MS the PTX didn't get that ack, so we go back and wait for
+ * the retry. After CONFIG_ESB_PRX_HOP_SCAN_AFTER_MS without any poll (PTX restarted, hops
+ * missed while in BLE mode) we walk esb_common_hop_channels until a poll turns up. In BLE
+ * mode the walk is left to the supervisor probes, alternating with the last polled channel.
+ */
+
+// channel esb_initialize() should use
+uint8_t hop_channel(void);
+
+// esb irq context, call with every received packet
+void hop_on_rx(const struct esb_payload *rx);
+
+// link supervisor: a probe from BLE mode found nobody, pick the channel for the next one
+void hop_probe_missed(void);
+
+#endif /* HOP_H_ */
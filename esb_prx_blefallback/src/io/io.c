@@ -18,8 +18,8 @@ BUILD_ASSERT(DT_SAME_NODE(DT_GPIO_CTLR(DT_ALIAS(led0), gpios),
                               DT_GPIO_CTLR(DT_ALIAS(led3), gpios)),
              "All LEDs must be on the same port");
 
-volatile int peripheral_number = -1; // used to select addr0 and channel in the inits
-extern struct k_work rf_swap_work;   // kernel work item to perform RF Swap.
+volatile int peripheral_number = CONFIG_ESB_PRX_PERIPHERAL_NUMBER; // used to select addr0/channel (or pipe) in the inits
+void rf_swap_request(void);          // main.c, performs the RF Swap.
 
 static struct gpio_callback button_callback;
 
@@ -66,7 +66,7 @@ void button_pressed(const struct device *dev, struct gpio_callback *cb, uint32_t
         LOG_DBG("BUTTON3");
         if (peripheral_number >= 0)
         {
-            k_work_submit(&rf_swap_work);
+            rf_swap_request();
         }
         break;
 
@@ -14,11 +14,28 @@
 #include <nrf.h>
 #include <esb.h>
 #include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/timing/timing.h>
 #include <zephyr/types.h>
 #include <nrfx_gpiote.h>
 
+#include "bcast/bcast.h"
 #include "ble/ble_service.h"
+#include "ble/data_service.h"
+#include "bulk/bulk.h"
+#include "duty/duty.h"
+#include "hop/hop.h"
 #include "io/io.h"
+#include "supervisor/supervisor.h"
+#include "tdma/tdma.h"
+#include "timeslot/timeslot.h"
+#include "txn/txn.h"
+#include "uplink/uplink.h"
+#include "esb_common.h"
+#include "esb_frame.h"
+#include "esb_rx_ring.h"
+#include "esb_trace.h"
+#include "link_stats.h"
 
 // radio debugs
 #include <debug/ppi_trace.h>
@@ -32,6 +49,7 @@ LOG_MODULE_REGISTER(esb_prx);
 #define RADIO_TEST_PIN 31
 static void radio_ppi_trace_setup(void)
 {
+#if defined(CONFIG_PPI_TRACE) // not available on the simulated radio
 	uint32_t start_evt;
 	uint32_t stop_evt;
 	void *handle;
@@ -46,51 +64,310 @@ static void radio_ppi_trace_setup(void)
 	__ASSERT(handle != NULL, "Failed to configure PPI trace pair.\n");
 
 	ppi_trace_enable(handle);
+#endif
 }
 
-static struct esb_payload rx_payload;
-static struct esb_payload tx_payload = ESB_CREATE_PAYLOAD(0,
-														  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17);
+static struct esb_rx_ring rx_ring; // filled by event_handler, drained by rx_thread
+static K_SEM_DEFINE(rx_sem, 0, 1);
+static atomic_t records_in; // application records unpacked from ptx payloads
+static atomic_t repeats_in; // data frames the ptx resent after losing our ack, their records were here already
+static atomic_t esb_rx_count;
 
-/* These are arbitrary default addresses. In end user products
- * different addresses should be used for each set of devices.
- */
-#define NUM_PRX_PERIPH 2
+// addresses and channels are shared with the ptx, see common/esb_common.c
+#define NUM_PRX_PERIPH ESB_COMMON_NUM_ADDR_SETS
 extern volatile int peripheral_number; // used to select addr0 and channel in the inits
+
+#if defined(CONFIG_ESB_PRX_HOP)
+#define SHARED_RF_CHANNEL hop_channel() // the ptx moves the fleet off the configured channel
+#else
+#define SHARED_RF_CHANNEL CONFIG_ESB_PRX_SHARED_RF_CHANNEL
+#endif
+
 volatile bool esb_running = true;
 
+static timing_t last_rx_time; // link stats on the prx track the time between polls
+
+#if defined(CONFIG_ESB_PRX_WARM_SWAP)
+// BLE -> ESB swap timing, the first poll we ack after the swap
+static volatile bool first_ack_pending;
+static timing_t first_ack_time;
+static timing_t slot_start_time;
+static K_SEM_DEFINE(first_ack_sem, 0, 1);
+#endif
+
+BUILD_ASSERT(IS_ENABLED(CONFIG_ESB_PRX_SHARED_CHANNEL) || CONFIG_ESB_PRX_PERIPHERAL_NUMBER < NUM_PRX_PERIPH,
+			 "Only peripheral 0 and 1 have their own address/channel, use the shared channel mode for more");
+BUILD_ASSERT(!IS_ENABLED(CONFIG_ESB_PRX_BCAST) || CONFIG_ESB_PRX_PERIPHERAL_NUMBER != ESB_COMMON_BCAST_PIPE,
+			 "The broadcast pipe can't be a peripheral number too");
+
+// esb callback, one packet the ptx sent to our own pipe
+static void rx_on_poll(struct esb_payload *rx)
+{
+#if defined(CONFIG_ESB_PRX_BCAST)
+	if (rx->pipe == ESB_COMMON_BCAST_PIPE)
+	{
+		return;
+	}
+#endif
+	ESB_TRACE_POINT(ESB_TRACE_RX, rx->pipe, rx->length, -rx->rssi, rx->data[0]);
+	txn_on_rx(rx); // a request swaps the queued ack payloads for its response
+	bulk_on_rx(rx);
+#if defined(CONFIG_ESB_PRX_HOP)
+	hop_on_rx(rx);
+#endif
+#if defined(CONFIG_ESB_PRX_TDMA_JIT)
+	tdma_on_rx(rx);
+#endif
+}
+
 void event_handler(struct esb_evt const *event)
 {
+	struct esb_payload *rx;
+	uint32_t from; // ring head before and after draining, the packets of this event
+	uint32_t to;
+	timing_t now;
+
 	switch (event->evt_id)
 	{
 	case ESB_EVENT_TX_SUCCESS:
-		LOG_DBG("TX SUCCESS EVENT");
+		ESB_TRACE_POINT(ESB_TRACE_ACK_DONE, 0, 0, 0, 0);
+		uplink_on_tx_success(); // the ptx got our last ack payload
+		link_stats_tx(0, true);
 		break;
 	case ESB_EVENT_TX_FAILED:
-		LOG_DBG("TX FAILED EVENT");
 		break;
 	case ESB_EVENT_RX_RECEIVED:
-		if (esb_read_rx_payload(&rx_payload) == 0)
+		now = timing_counter_get();
+		atomic_inc(&esb_rx_count);
+		// drain the whole fifo, several packets can land per event. no logging in here.
+		from = atomic_get(&rx_ring.head);
+		rx = esb_rx_ring_fill(&rx_ring);
+		to = atomic_get(&rx_ring.head);
+#if defined(CONFIG_ESB_PRX_BCAST)
+		// a poll and a broadcast can come in the same event, broadcasts alone (or nothing drained) skip
+		// the poll handling
+		bool polled = rx == &rx_ring.scratch && rx->pipe != ESB_COMMON_BCAST_PIPE;
+
+		for (uint32_t i = from; i != to; i++)
 		{
-			LOG_DBG("Packet received, len %d : "
-					"0x%02x, 0x%02x, 0x%02x, 0x%02x, "
-					"0x%02x, 0x%02x, 0x%02x, 0x%02x",
-					rx_payload.length, rx_payload.data[0],
-					rx_payload.data[1], rx_payload.data[2],
-					rx_payload.data[3], rx_payload.data[4],
-					rx_payload.data[5], rx_payload.data[6],
-					rx_payload.data[7]);
+			struct esb_payload *p = &rx_ring.slots[i & (ESB_RX_RING_SIZE - 1)];
+
+			if (p->pipe == ESB_COMMON_BCAST_PIPE)
+			{
+				ESB_TRACE_POINT(ESB_TRACE_BCAST, p->pipe, p->length, -p->rssi, p->data[1]);
+			}
+			polled = polled || p->pipe != ESB_COMMON_BCAST_PIPE;
 		}
-		else
+		if (!polled)
 		{
-			LOG_ERR("Error while reading rx packet");
+			// not a poll: nothing was acked and no ack payload went out, the rx thread has the rest
+			k_sem_give(&rx_sem);
+			break;
 		}
-		LOG_INF("RX RECEIVED");
+#endif
+#if defined(CONFIG_ESB_PRX_WARM_SWAP)
+		if (first_ack_pending)
+		{
+			first_ack_pending = false;
+			first_ack_time = now;
+			k_sem_give(&first_ack_sem);
+		}
+#endif
+#if defined(CONFIG_ESB_PRX_LINK_SUPERVISOR)
+		supervisor_on_poll();
+#endif
+#if defined(CONFIG_ESB_PRX_DUTY_CYCLE)
+		duty_on_poll();
+#endif
+		link_stats_latency(0, timing_cycles_get(&last_rx_time, &now));
+		last_rx_time = now;
+		uplink_on_rx(); // top the ack payloads back up right away, the next poll can be close
+		// every poll of the event, oldest first. with the ring full the newest (in scratch) is all that's left.
+		for (uint32_t i = from; i != to; i++)
+		{
+			rx_on_poll(&rx_ring.slots[i & (ESB_RX_RING_SIZE - 1)]);
+		}
+		if (rx == &rx_ring.scratch)
+		{
+			rx_on_poll(rx);
+		}
+		k_sem_give(&rx_sem);
 		nrf_gpio_pin_toggle(TEST_PIN); // faster
 		break;
 	}
 }
 
+// rx consumer thread, handles what the esb callback put in the ring
+#define RX_THREAD_STACK_SIZE 1024
+#define RX_THREAD_PRIORITY 5
+
+static void rx_thread(void)
+{
+	atomic_val_t reported_overflows = 0;
+	struct esb_payload *rx_payload;
+	bool data_seen = false;
+	uint8_t data_last_seq = 0;
+
+	while (1)
+	{
+		k_sem_take(&rx_sem, K_FOREVER);
+
+		while ((rx_payload = esb_rx_ring_peek(&rx_ring)) != NULL)
+		{
+			const struct esb_proto_hdr *hdr = (const struct esb_proto_hdr *)rx_payload->data;
+			const uint8_t *record;
+			uint8_t offset = 0;
+			uint8_t len;
+
+			bool records = rx_payload->length >= ESB_PROTO_HDR_LEN && hdr->type == ESB_PROTO_DATA;
+
+			// the ptx moves its sequence number on only once a frame with records is acked
+			if (records && rx_payload->length > ESB_PROTO_HDR_LEN)
+			{
+				if (data_seen && hdr->id == data_last_seq)
+				{
+					records = false;
+					atomic_inc(&repeats_in);
+				}
+				data_seen = true;
+				data_last_seq = hdr->id;
+			}
+#if defined(CONFIG_ESB_PRX_BCAST)
+			// every copy of a broadcast has the same sequence number, its records only go up once
+			records = records || (rx_payload->length >= ESB_PROTO_HDR_LEN && hdr->type == ESB_PROTO_BCAST &&
+								  bcast_accept(hdr->id));
+#endif
+
+			// transaction requests are answered from the esb callback already
+			if (records)
+			{
+				while ((record = esb_frame_next(rx_payload, &offset, &len)) != NULL)
+				{
+					ESB_TRACE_POINT(ESB_TRACE_RECORD, rx_payload->pipe, len, 0, len > 1 ? sys_get_le16(record) : record[0]);
+					atomic_inc(&records_in);
+				}
+			}
+			link_stats_rx(0, rx_payload->rssi, rx_payload->length);
+			esb_rx_ring_release(&rx_ring);
+		}
+
+		atomic_val_t overflows = atomic_get(&rx_ring.overflows);
+		if (overflows != reported_overflows)
+		{
+			LOG_WRN("RX ring full, %ld packets dropped so far", overflows);
+			reported_overflows = overflows;
+		}
+	}
+}
+
+K_THREAD_DEFINE(rx_thread_id, RX_THREAD_STACK_SIZE, rx_thread, NULL, NULL, NULL, RX_THREAD_PRIORITY, 0, 0);
+
+// demo transaction handler, runs in the esb callback: answers with the request bytes reversed
+static uint8_t txn_reverse_handler(const uint8_t *req, uint8_t req_len, uint8_t *rsp, uint8_t rsp_max)
+{
+	uint8_t len = MIN(req_len, rsp_max);
+
+	for (uint8_t i = 0; i < len; i++)
+	{
+		rsp[i] = req[len - 1 - i];
+	}
+
+	return len;
+}
+
+// demo bulk object 0, a counting pattern the ptx can pull with "bulk <node> 0". const, so 4 KB of flash instead of RAM.
+#define BULK_DEMO_BYTE(i, _) i
+#define BULK_DEMO_256 LISTIFY(256, BULK_DEMO_BYTE, (,))
+static const uint8_t bulk_demo[] = {
+	BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256,
+	BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256, BULK_DEMO_256,
+};
+
+static int bulk_demo_source(uint8_t object, const uint8_t **data)
+{
+	if (object != 0)
+	{
+		return -ENOENT;
+	}
+
+	*data = bulk_demo;
+	return sizeof(bulk_demo);
+}
+
+// demo sensor, queues a fresh sample for the ack payloads every CONFIG_ESB_PRX_SAMPLE_PERIOD_MS.
+// started from main once esb is up.
+#define SAMPLE_THREAD_STACK_SIZE 1024
+#define SAMPLE_THREAD_PRIORITY 6
+
+static void sample_thread(void)
+{
+	uint32_t seq = 0;
+	int64_t report_time = k_uptime_get() + MSEC_PER_SEC;
+	uint8_t sample[UPLINK_SAMPLE_MAX_LEN];
+	struct uplink_stats stats;
+	struct data_service_stats ble_stats;
+
+	while (1)
+	{
+		sys_put_le32(seq, &sample[0]);
+		sys_put_le32(k_cycle_get_32(), &sample[4]);
+		if (esb_running)
+		{
+			uplink_put(sample, sizeof(sample));
+		}
+		// same records over the ble fallback, to whoever subscribed
+		if (data_service_subscribed())
+		{
+			data_service_put(sample, sizeof(sample));
+		}
+		seq++;
+
+		if (k_uptime_get() >= report_time)
+		{
+			uplink_stats_get(&stats);
+			LOG_INF("uplink: %u acks/sec (%u records), %u empty, %u stale, data age avg %u us max %u us",
+					stats.acks_sent, stats.records_sent, stats.fifo_empty, stats.stale_dropped, stats.age_avg_us,
+					stats.age_max_us);
+			LOG_INF("downlink: %ld records/sec, %ld repeats dropped", atomic_clear(&records_in),
+					atomic_clear(&repeats_in));
+			data_service_stats_get(&ble_stats);
+			if (ble_stats.notifications || ble_stats.dropped)
+			{
+				LOG_INF("ble: %u records/sec in %u notifications, %u bytes/sec, %u dropped", ble_stats.records,
+						ble_stats.notifications, ble_stats.bytes, ble_stats.dropped);
+			}
+#if defined(CONFIG_ESB_PRX_CONCURRENT_BLE)
+			struct timeslot_stats slots;
+
+			timeslot_stats_get(&slots);
+			LOG_INF("esb: %ld packets/sec in %u timeslots (%u blocked), ble %s", atomic_clear(&esb_rx_count),
+					slots.started, slots.blocked, app_bt_connected() ? "connected" : "not connected");
+#else
+			LOG_INF("esb: %ld packets/sec", atomic_clear(&esb_rx_count));
+#endif
+#if defined(CONFIG_ESB_PRX_DUTY_CYCLE)
+			struct duty_stats duty;
+
+			duty_stats_get(&duty);
+			LOG_INF("rx duty: %s, period %u us, radio on %u.%u%% (%u ms/h), %u windows missed",
+					duty.locked ? "locked" : "learning", duty.period_us, duty.on_permille / 10,
+					duty.on_permille % 10, duty.on_ms_per_hour, duty.windows_missed);
+#endif
+			report_time += MSEC_PER_SEC;
+		}
+
+#if defined(CONFIG_ESB_PRX_TDMA_JIT)
+		// one sample per poll, taken right before it
+		tdma_wait_sample(K_MSEC(CONFIG_ESB_PRX_SAMPLE_PERIOD_MS));
+#else
+		k_msleep(CONFIG_ESB_PRX_SAMPLE_PERIOD_MS);
+#endif
+	}
+}
+
+K_THREAD_DEFINE(sample_thread_id, SAMPLE_THREAD_STACK_SIZE, sample_thread, NULL, NULL, NULL, SAMPLE_THREAD_PRIORITY, 0,
+				SYS_FOREVER_MS);
+
 int clocks_start(void)
 {
 	int err;
@@ -132,11 +409,6 @@ int esb_initialize(void)
 {
 	int err;
 
-	uint8_t g_base_addr_0[NUM_PRX_PERIPH][4] = {{0xE7, 0xE7, 0xE7, 0xE7}, {0xEE, 0xEE, 0xEE, 0xEE}};
-	uint8_t base_addr_1[4] = {0xC2, 0xC2, 0xC2, 0xC2};
-	uint8_t addr_prefix[8] = {0xE7, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8};
-	uint32_t g_channels[NUM_PRX_PERIPH] = {2, 4}; // channel selection per periph
-
 	struct esb_config config = ESB_DEFAULT_CONFIG;
 
 	config.protocol = ESB_PROTOCOL_ESB_DPL;
@@ -153,44 +425,83 @@ int esb_initialize(void)
 		return err;
 	}
 
-	err = esb_set_base_address_0(g_base_addr_0[peripheral_number]);
+	// shared channel: everyone uses the first address set, the peripheral number is the pipe.
+	int addr_choice = IS_ENABLED(CONFIG_ESB_PRX_SHARED_CHANNEL) ? 0 : peripheral_number;
+
+	err = esb_set_base_address_0(esb_common_base_addr_0[addr_choice]);
 	if (err)
 	{
 		return err;
 	}
 
-	err = esb_set_base_address_1(base_addr_1);
+	err = esb_set_base_address_1(esb_common_base_addr_1);
 	if (err)
 	{
 		return err;
 	}
 
-	err = esb_set_prefixes(addr_prefix, ARRAY_SIZE(addr_prefix));
+	err = esb_set_prefixes(esb_common_addr_prefix, ARRAY_SIZE(esb_common_addr_prefix));
 	if (err)
 	{
 		return err;
 	}
 
-	err = esb_set_rf_channel(g_channels[peripheral_number]);
+#if defined(CONFIG_ESB_PRX_SHARED_CHANNEL)
+	err = esb_set_rf_channel(SHARED_RF_CHANNEL);
 	if (err)
 	{
 		return err;
 	}
 
+	// only answer on our own pipe so the other PRXs on this channel don't ack for us
+#if defined(CONFIG_ESB_PRX_BCAST)
+	err = esb_enable_pipes(BIT(peripheral_number) | BIT(ESB_COMMON_BCAST_PIPE)); // the ptx only sends noack frames there
+#else
+	err = esb_enable_pipes(BIT(peripheral_number));
+#endif
+	if (err)
+	{
+		return err;
+	}
+
+	uplink_init(peripheral_number); // ack payloads are queued per pipe
+#else
+	err = esb_set_rf_channel(esb_common_channels[addr_choice]);
+	if (err)
+	{
+		return err;
+	}
+
+	uplink_init(0);
+#endif
+
+#if defined(CONFIG_ESB_PRX_DUTY_CYCLE)
+	duty_reset();
+#endif
 	return 0;
 }
 
 // RF Swap workQ
-// So it runs from a cooperative thread. Work thread is cooperative, so calling fxn as work item works. Invoked in button callback in io.c
-struct k_work rf_swap_work;
+// So it runs from a cooperative thread. Work thread is cooperative, so calling fxn as work item works.
+static struct k_work rf_swap_work;
 static void rf_swap_work_fxn(struct k_work *work)
 {
+	if (IS_ENABLED(CONFIG_ESB_PRX_CONCURRENT_BLE))
+	{
+		LOG_INF("ESB and BLE already run side by side, nothing to swap");
+		return;
+	}
+
 	if (esb_running)
 	{
 		LOG_INF("Disable ESB, Enable BLE");
 		esb_running = false;
+#if defined(CONFIG_ESB_PRX_DUTY_CYCLE)
+		duty_stop();
+#endif
 		// esb_stop_rx();
 		esb_disable();
+		uplink_stop();
 		app_bt_restart();
 	}
 	else
@@ -199,10 +510,225 @@ static void rf_swap_work_fxn(struct k_work *work)
 		esb_running = true;
 		bt_disable();
 		esb_initialize();
+		uplink_refill();
 		esb_start_rx();
 	}
 }
 
+#if defined(CONFIG_ESB_PRX_CONCURRENT_BLE) || defined(CONFIG_ESB_PRX_WARM_SWAP)
+// timeslot SWI context. esb is set up from scratch every slot, BLE reconfigures the radio in between.
+static void timeslot_evt_handler(enum timeslot_evt evt)
+{
+	switch (evt)
+	{
+	case TIMESLOT_EVT_START:
+#if defined(CONFIG_ESB_PRX_WARM_SWAP)
+		slot_start_time = timing_counter_get();
+#endif
+		if (esb_initialize() == 0)
+		{
+			uplink_refill();
+			esb_start_rx();
+		}
+		break;
+	case TIMESLOT_EVT_END:
+#if defined(CONFIG_ESB_PRX_DUTY_CYCLE)
+		duty_stop(); // mpsl can end the slot on its own too
+#endif
+		uplink_stop(); // esb_disable() already ran before the radio went back
+		break;
+	}
+}
+#endif
+
+#if defined(CONFIG_ESB_PRX_WARM_SWAP)
+// one slot for as long as mpsl lets us, extended in steps of the longest allowed length
+static const struct timeslot_cfg warm_slot_cfg = {
+	.length_us = 100000,
+	.interval_us = 0,
+};
+
+#define SWAP_THREAD_STACK_SIZE 1024
+#define SWAP_ACK_TIMEOUT_MS 2000 // give up waiting for a poll, the ptx may be off
+
+static K_SEM_DEFINE(swap_sem, 0, 1);
+
+static uint32_t swap_us(timing_t *start, timing_t *end)
+{
+	return (uint32_t)(timing_cycles_to_ns(timing_cycles_get(start, end)) / NSEC_PER_USEC);
+}
+
+static void warm_swap_to_ble(void)
+{
+	timing_t start = timing_counter_get();
+	timing_t end;
+
+	esb_running = false;
+#if defined(CONFIG_ESB_PRX_DUTY_CYCLE)
+	duty_stop();
+#endif
+	timeslot_close(); // esb is disabled and the radio is back with mpsl when this returns
+	if (app_bt_adv_start() == 0)
+	{
+		end = timing_counter_get();
+		LOG_INF("swap: ESB -> advertising in %u us", swap_us(&start, &end));
+	}
+}
+
+#if defined(CONFIG_ESB_PRX_LINK_SUPERVISOR)
+// short periodic slots, a connection with a short interval keeps its events while we probe
+static const struct timeslot_cfg probe_slot_cfg = {
+	.length_us = CONFIG_ESB_PRX_PROBE_SLOT_LENGTH_US,
+	.interval_us = CONFIG_ESB_PRX_PROBE_SLOT_INTERVAL_US,
+};
+
+BUILD_ASSERT(CONFIG_ESB_PRX_PROBE_SLOT_LENGTH_US < CONFIG_ESB_PRX_PROBE_SLOT_INTERVAL_US,
+			 "The probe slot must be shorter than its interval");
+#endif
+
+// opens the esb timeslot session and waits for the first poll. ble is left as it is.
+static bool warm_esb_listen(const struct timeslot_cfg *cfg, k_timeout_t timeout)
+{
+	first_ack_pending = true;
+	k_sem_reset(&first_ack_sem);
+	esb_running = true;
+
+	int err = timeslot_open(cfg, timeslot_evt_handler);
+	if (err)
+	{
+		first_ack_pending = false;
+		LOG_ERR("Timeslot session failed, err %d", err);
+		return false;
+	}
+
+	if (k_sem_take(&first_ack_sem, timeout) == 0)
+	{
+		return true;
+	}
+
+	first_ack_pending = false;
+	return false;
+}
+
+static void warm_swap_to_esb(void)
+{
+	timing_t start = timing_counter_get();
+
+	app_bt_adv_stop();
+	if (warm_esb_listen(&warm_slot_cfg, K_MSEC(SWAP_ACK_TIMEOUT_MS)))
+	{
+		LOG_INF("swap: BLE -> ESB radio in %u us, first ack in %u us", swap_us(&start, &slot_start_time),
+				swap_us(&start, &first_ack_time));
+	}
+	else
+	{
+		LOG_WRN("swap: BLE -> ESB, no poll within %d ms", SWAP_ACK_TIMEOUT_MS);
+	}
+}
+
+#if defined(CONFIG_ESB_PRX_LINK_SUPERVISOR)
+// listen for the ptx in timeslots between the ble events, only drop ble if it's there
+static void warm_probe(void)
+{
+	timing_t start = timing_counter_get();
+	bool found = warm_esb_listen(&probe_slot_cfg, K_MSEC(CONFIG_ESB_PRX_PROBE_WINDOW_MS));
+
+	// the probe slots end either way, a found ptx gets the continuous slot
+	esb_running = false;
+#if defined(CONFIG_ESB_PRX_DUTY_CYCLE)
+	duty_stop();
+#endif
+	timeslot_close();
+
+	if (found)
+	{
+		uint32_t first_ack_us = swap_us(&start, &first_ack_time);
+
+		app_bt_adv_stop();
+		if (warm_esb_listen(&warm_slot_cfg, K_MSEC(SWAP_ACK_TIMEOUT_MS)))
+		{
+			LOG_INF("link: PTX is back, ESB again, first ack %u us into the probe", first_ack_us);
+		}
+		else
+		{
+			LOG_WRN("link: PTX answered a probe but no poll within %d ms of switching over", SWAP_ACK_TIMEOUT_MS);
+		}
+	}
+#if defined(CONFIG_ESB_PRX_HOP)
+	else
+	{
+		hop_probe_missed();
+	}
+#endif
+
+	supervisor_probe_result(found);
+}
+#endif
+
+// host stays enabled, a swap is advertising on/off + the esb timeslot session.
+// started from main once the peripheral number is known, esb first.
+static void swap_thread(void)
+{
+	warm_swap_to_esb();
+#if defined(CONFIG_ESB_PRX_LINK_SUPERVISOR)
+	supervisor_set_mode(LINK_MODE_ESB, false);
+#endif
+
+	while (1)
+	{
+#if defined(CONFIG_ESB_PRX_LINK_SUPERVISOR)
+		if (k_sem_take(&swap_sem, supervisor_timeout()) != 0)
+		{
+			switch (supervisor_check())
+			{
+			case SUPERVISOR_FAILOVER:
+				warm_swap_to_ble();
+				supervisor_set_mode(LINK_MODE_BLE, false);
+				break;
+			case SUPERVISOR_PROBE:
+				warm_probe();
+				break;
+			default:
+				break;
+			}
+			continue;
+		}
+#else
+		k_sem_take(&swap_sem, K_FOREVER);
+#endif
+
+		// button: ble picked by hand stays until the next press
+		if (esb_running)
+		{
+			warm_swap_to_ble();
+#if defined(CONFIG_ESB_PRX_LINK_SUPERVISOR)
+			supervisor_set_mode(LINK_MODE_BLE, true);
+#endif
+		}
+		else
+		{
+			warm_swap_to_esb();
+#if defined(CONFIG_ESB_PRX_LINK_SUPERVISOR)
+			supervisor_set_mode(LINK_MODE_ESB, false);
+#endif
+		}
+	}
+}
+
+K_THREAD_DEFINE(swap_thread_id, SWAP_THREAD_STACK_SIZE, swap_thread, NULL, NULL, NULL,
+				CONFIG_ESB_PRX_SWAP_THREAD_PRIORITY, 0, SYS_FOREVER_MS);
+#endif
+
+// button 3, io.c
+void rf_swap_request(void)
+{
+#if defined(CONFIG_ESB_PRX_WARM_SWAP)
+	k_sem_give(&swap_sem);
+#else
+	k_work_submit(&rf_swap_work);
+#endif
+}
+
 int main(void)
 {
 	int err;
@@ -211,6 +737,13 @@ int main(void)
 
 	radio_ppi_trace_setup();
 
+	timing_init();
+	timing_start();
+
+	txn_set_handler(txn_reverse_handler);
+
+	bulk_set_source(bulk_demo_source);
+
 	k_work_init(&rf_swap_work, rf_swap_work_fxn);
 
 	err = clocks_start();
@@ -244,6 +777,30 @@ int main(void)
 		k_msleep(100);
 	}
 
+#if defined(CONFIG_ESB_PRX_CONCURRENT_BLE)
+	// BLE stays up, ESB gets the radio in MPSL timeslots
+	k_thread_start(sample_thread_id);
+
+	static const struct timeslot_cfg slot_cfg = {
+		.length_us = CONFIG_ESB_PRX_TIMESLOT_LENGTH_US,
+		.interval_us = CONFIG_ESB_PRX_TIMESLOT_INTERVAL_US,
+	};
+
+	err = timeslot_open(&slot_cfg, timeslot_evt_handler);
+	if (err)
+	{
+		LOG_ERR("Timeslot session failed, err %d", err);
+	}
+
+	return 0;
+#elif defined(CONFIG_ESB_PRX_WARM_SWAP)
+	// esb app first, but the host stays up for the swaps
+	k_thread_start(sample_thread_id);
+	k_thread_start(swap_thread_id);
+
+	return 0;
+#endif
+
 	bt_disable(); // esb app first
 	err = esb_initialize();
 	if (err)
@@ -254,12 +811,8 @@ int main(void)
 
 	LOG_INF("Initialization complete");
 
-	err = esb_write_payload(&tx_payload);
-	if (err)
-	{
-		LOG_ERR("Write payload, err %d", err);
-		return 0;
-	}
+	// ack payloads come from the uplink queue from here on, sample_thread keeps it fed
+	k_thread_start(sample_thread_id);
 
 	LOG_INF("Setting up for packet receiption");
 
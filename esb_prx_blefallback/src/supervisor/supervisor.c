@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+#include "supervisor.h"
+
+LOG_MODULE_REGISTER(supervisor);
+
+static enum link_mode mode = LINK_MODE_ESB;
+static bool mode_pinned;
+static int64_t mode_since_ms;
+static int64_t next_probe_ms;
+static volatile uint32_t last_poll_ms; // k_uptime_get_32(), written by the esb callback
+
+static struct supervisor_stats totals;
+static struct k_spinlock stats_lock; // swap thread updates, shell reads
+
+static void account_mode_time(int64_t now)
+{
+	uint32_t elapsed = (uint32_t)(now - mode_since_ms);
+
+	if (mode == LINK_MODE_ESB)
+	{
+		totals.esb_ms += elapsed;
+	}
+	else
+	{
+		totals.ble_ms += elapsed;
+	}
+	mode_since_ms = now;
+}
+
+void supervisor_set_mode(enum link_mode new_mode, bool pinned)
+{
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	account_mode_time(now);
+	mode = new_mode;
+	mode_pinned = pinned;
+	k_spin_unlock(&stats_lock, key);
+
+	// a fresh esb mode gets the full timeout before the first poll is due
+	last_poll_ms = (uint32_t)now;
+	next_probe_ms = now + CONFIG_ESB_PRX_PROBE_INTERVAL_MS;
+}
+
+enum link_mode supervisor_mode(void)
+{
+	return mode;
+}
+
+void supervisor_on_poll(void)
+{
+	last_poll_ms = k_uptime_get_32();
+}
+
+k_timeout_t supervisor_timeout(void)
+{
+	int64_t now = k_uptime_get();
+
+	if (mode == LINK_MODE_ESB)
+	{
+		uint32_t quiet_ms = (uint32_t)now - last_poll_ms;
+
+		return quiet_ms < CONFIG_ESB_PRX_SUPERVISION_TIMEOUT_MS
+				   ? K_MSEC(CONFIG_ESB_PRX_SUPERVISION_TIMEOUT_MS - quiet_ms)
+				   : K_NO_WAIT;
+	}
+
+	if (mode_pinned)
+	{
+		return K_FOREVER;
+	}
+
+	return next_probe_ms > now ? K_MSEC(next_probe_ms - now) : K_NO_WAIT;
+}
+
+enum supervisor_action supervisor_check(void)
+{
+	int64_t now = k_uptime_get();
+
+	if (mode == LINK_MODE_ESB)
+	{
+		uint32_t quiet_ms = (uint32_t)now - last_poll_ms;
+
+		if (quiet_ms < CONFIG_ESB_PRX_SUPERVISION_TIMEOUT_MS)
+		{
+			return SUPERVISOR_NONE;
+		}
+
+		LOG_WRN("No poll for %u ms, falling back to BLE", quiet_ms);
+		k_spinlock_key_t key = k_spin_lock(&stats_lock);
+		totals.failovers++;
+		k_spin_unlock(&stats_lock, key);
+		return SUPERVISOR_FAILOVER;
+	}
+
+	if (mode_pinned || now < next_probe_ms)
+	{
+		return SUPERVISOR_NONE;
+	}
+
+	return SUPERVISOR_PROBE;
+}
+
+void supervisor_probe_result(bool ptx_found)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	totals.probes++;
+	if (ptx_found)
+	{
+		totals.returns++;
+	}
+	k_spin_unlock(&stats_lock, key);
+
+	if (ptx_found)
+	{
+		supervisor_set_mode(LINK_MODE_ESB, false);
+	}
+	else
+	{
+		next_probe_ms = k_uptime_get() + CONFIG_ESB_PRX_PROBE_INTERVAL_MS;
+	}
+}
+
+void supervisor_stats_get(struct supervisor_stats *stats)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	account_mode_time(k_uptime_get());
+	*stats = totals;
+	k_spin_unlock(&stats_lock, key);
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_link(const struct shell *sh, size_t argc, char **argv)
+{
+	struct supervisor_stats stats;
+
+	supervisor_stats_get(&stats);
+	shell_print(sh, "mode %s%s, esb %u ms, ble %u ms", mode == LINK_MODE_ESB ? "esb" : "ble",
+				mode_pinned ? " (pinned)" : "", stats.esb_ms, stats.ble_ms);
+	shell_print(sh, "%u failovers, %u probes, %u returns to esb", stats.failovers, stats.probes, stats.returns);
+	return 0;
+}
+
+SHELL_CMD_REGISTER(link, NULL, "ESB/BLE link supervisor state and time in each mode", cmd_link);
+#endif
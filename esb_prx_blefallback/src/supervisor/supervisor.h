@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef SUPERVISOR_H_
+#define SUPERVISOR_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+
+/* PRX link supervisor, the policy half of the automatic ESB <-> BLE failover. The swap
+ * thread in main.c does the actual swapping: it sleeps for supervisor_timeout(), asks
+ * supervisor_check() what to do and reports back with supervisor_set_mode() and
+ * supervisor_probe_result().
+ *  - ESB with no poll for CONFIG_ESB_PRX_SUPERVISION_TIMEOUT_MS: fail over to BLE
+ *  - BLE: every CONFIG_ESB_PRX_PROBE_INTERVAL_MS listen for a poll next to the BLE
+ *    traffic, back to ESB if one arrives within CONFIG_ESB_PRX_PROBE_WINDOW_MS
+ * A BLE mode picked with the button is pinned, no probes until the next swap.
+ */
+
+enum link_mode
+{
+	LINK_MODE_ESB,
+	LINK_MODE_BLE,
+};
+
+enum supervisor_action
+{
+	SUPERVISOR_NONE,
+	SUPERVISOR_FAILOVER, // swap to BLE
+	SUPERVISOR_PROBE,	 // listen for a poll without giving up BLE
+};
+
+struct supervisor_stats
+{
+	uint32_t esb_ms; // time in each mode, probes count as BLE
+	uint32_t ble_ms;
+	uint32_t failovers;
+	uint32_t probes;
+	uint32_t returns; // probes that found the ptx
+};
+
+void supervisor_set_mode(enum link_mode mode, bool pinned);
+enum link_mode supervisor_mode(void);
+
+// esb irq context, every received packet
+void supervisor_on_poll(void);
+
+// how long the swap thread can sleep before the next supervisor_check()
+k_timeout_t supervisor_timeout(void);
+enum supervisor_action supervisor_check(void);
+void supervisor_probe_result(bool ptx_found);
+
+void supervisor_stats_get(struct supervisor_stats *stats);
+
+#endif /* SUPERVISOR_H_ */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "esb_proto.h"
+#include "tdma.h"
+
+LOG_MODULE_REGISTER(tdma);
+
+#define LOST_AFTER_CYCLES 8 // polls missed in a row before the schedule is dropped
+
+static volatile uint32_t cycle_us;	  // 0 until the first sync
+static uint32_t late_us;			  // of the last sync, the data polls don't say
+static volatile int64_t anchor_ticks; // last poll the timer was lined up with
+
+static K_SEM_DEFINE(sample_sem, 0, 1);
+
+static void jit_timer_fxn(struct k_timer *timer)
+{
+	k_sem_give(&sample_sem);
+}
+
+static K_TIMER_DEFINE(jit_timer, jit_timer_fxn, NULL);
+
+void tdma_on_rx(const struct esb_payload *rx)
+{
+	const struct esb_proto_hdr *hdr = (const struct esb_proto_hdr *)rx->data;
+	int64_t now = k_uptime_ticks();
+
+	if (rx->length >= ESB_PROTO_HDR_LEN + sizeof(struct esb_proto_sync) && hdr->type == ESB_PROTO_SYNC)
+	{
+		const struct esb_proto_sync *sync = (const struct esb_proto_sync *)&rx->data[ESB_PROTO_HDR_LEN];
+
+		cycle_us = sys_le32_to_cpu(sync->cycle_us);
+		late_us = sys_le32_to_cpu(sync->late_us);
+	}
+	else if (rx->length < ESB_PROTO_HDR_LEN || hdr->type != ESB_PROTO_DATA)
+	{
+		return; // transactions, bulk requests and hops don't go out at the slot start
+	}
+
+	if (cycle_us == 0 || late_us >= cycle_us)
+	{
+		return;
+	}
+
+	// keeps firing every cycle if polls go missing, the next one pulls it back in line
+	int64_t slot = now - k_us_to_ticks_near64(late_us);
+
+	anchor_ticks = now;
+	int64_t wake = slot + k_us_to_ticks_near64(cycle_us - MIN(CONFIG_ESB_PRX_TDMA_LEAD_US, cycle_us));
+
+	k_timer_start(&jit_timer, K_TIMEOUT_ABS_TICKS(wake), K_USEC(cycle_us));
+}
+
+void tdma_wait_sample(k_timeout_t unsynced_period)
+{
+	uint32_t cycle = cycle_us;
+
+	if (cycle == 0)
+	{
+		k_sleep(unsynced_period);
+		return;
+	}
+
+	k_sem_take(&sample_sem, K_USEC(2 * cycle));
+
+	// the timer keeps running through missed polls, drop it once the ptx is really gone
+	if (k_uptime_ticks() - anchor_ticks > k_us_to_ticks_near64((uint64_t)LOST_AFTER_CYCLES * cycle))
+	{
+		k_timer_stop(&jit_timer);
+		cycle_us = 0;
+		LOG_WRN("Not polled for %d cycles, sampling freely until the next sync", LOST_AFTER_CYCLES);
+	}
+}
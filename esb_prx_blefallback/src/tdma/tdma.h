@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef TDMA_H_
+#define TDMA_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* PRX side of the PTX's fixed poll schedule. ESB_PROTO_SYNC frames give the cycle and how
+ * late that poll went out, every poll re-anchors the slot. A kernel timer (RTC compare,
+ * 30.5 us resolution) fires CONFIG_ESB_PRX_TDMA_LEAD_US before the next expected poll so
+ * the sample is taken and queued as ack payload right before the PTX comes for it.
+ */
+
+// esb irq context, call with every received packet
+void tdma_on_rx(const struct esb_payload *rx);
+
+// sample thread: returns when it's time to sample for the next poll. without a schedule
+// (no sync yet) it just sleeps for unsynced_period.
+void tdma_wait_sample(k_timeout_t unsynced_period);
+
+#endif /* TDMA_H_ */
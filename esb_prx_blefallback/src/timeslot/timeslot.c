@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <zephyr/irq.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <esb.h>
+#include <hal/nrf_timer.h>
+#include <mpsl.h>
+#include <mpsl_timeslot.h>
+#include <mpsl/mpsl_work.h>
+
+#include "timeslot.h"
+
+LOG_MODULE_REGISTER(timeslot);
+
+#define SLOT_END_MARGIN_US 500 // swi latency + esb_disable() + the TIMER0 round trip that ends the slot
+#define SLOT_END_NOW_US 20	   // timeslot_close() and the teardown: end a running slot this soon
+
+// start/end are passed on to the app through a SWI, the MPSL callback runs as a zero latency irq
+#define TIMESLOT_SWI_IRQn SWI3_EGU3_IRQn
+#define TIMESLOT_SWI_PRIORITY 2
+
+static mpsl_timeslot_session_id_t session_id;
+static bool session_open;
+static struct timeslot_cfg slot_cfg;
+static timeslot_cb_t app_cb;
+static atomic_t pending_evts; // BIT(enum timeslot_evt), plus PENDING_REQUEST
+#define PENDING_REQUEST BIT(TIMESLOT_EVT_END + 1)
+
+static volatile bool in_slot;
+static volatile bool end_requested;
+static volatile bool ending;		// teardown pending in the swi
+static volatile bool torn_down;		// esb let go of the radio, the next TIMER0 signal ends the slot
+static volatile bool extend_failed; // end the slot and queue up again
+static K_SEM_DEFINE(slot_ended_sem, 0, 1);
+
+static atomic_t slots_started;
+static atomic_t slots_blocked;
+
+static mpsl_timeslot_request_t req_earliest = {
+	.request_type = MPSL_TIMESLOT_REQ_TYPE_EARLIEST,
+	.params.earliest = {
+		.hfclk = MPSL_TIMESLOT_HFCLK_CFG_NO_GUARANTEE,
+		.priority = MPSL_TIMESLOT_PRIORITY_NORMAL,
+		.timeout_us = 1000000,
+	},
+};
+
+static mpsl_timeslot_request_t req_next = {
+	.request_type = MPSL_TIMESLOT_REQ_TYPE_NORMAL,
+	.params.normal = {
+		.hfclk = MPSL_TIMESLOT_HFCLK_CFG_NO_GUARANTEE,
+		.priority = MPSL_TIMESLOT_PRIORITY_NORMAL,
+	},
+};
+
+static mpsl_timeslot_signal_return_param_t signal_return;
+static uint32_t slot_end_us; // TIMER0 time the slot (with extensions) runs out
+
+// same wrapper MPSL connects itself with CONFIG_MPSL_DYNAMIC_INTERRUPTS
+static void mpsl_radio_isr_wrapper(const void *args)
+{
+	ARG_UNUSED(args);
+	MPSL_IRQ_RADIO_Handler();
+	ISR_DIRECT_PM();
+}
+
+static void request_work_fxn(struct k_work *work)
+{
+	// a blocked/cancelled slot can't be followed up with a request from the callback itself
+	if (session_open && !end_requested)
+	{
+		int32_t err = mpsl_timeslot_request(session_id, &req_earliest);
+		if (err)
+		{
+			LOG_ERR("Timeslot request failed, err %d", err);
+		}
+	}
+}
+
+static K_WORK_DEFINE(request_work, request_work_fxn);
+
+static void timeslot_swi_isr(const void *args)
+{
+	ARG_UNUSED(args);
+	atomic_val_t evts = atomic_clear(&pending_evts);
+
+	// an end can't be pending without the start before it, handle them in order
+	if ((evts & BIT(TIMESLOT_EVT_START)) && app_cb)
+	{
+		app_cb(TIMESLOT_EVT_START);
+	}
+	if (evts & BIT(TIMESLOT_EVT_END))
+	{
+		// esb_init() took the RADIO irq over, give it back before MPSL needs it
+		esb_disable();
+		irq_disable(RADIO_IRQn);
+		irq_connect_dynamic(RADIO_IRQn, MPSL_HIGH_IRQ_PRIORITY, mpsl_radio_isr_wrapper, NULL, IRQ_ZERO_LATENCY);
+		irq_enable(RADIO_IRQn);
+
+		torn_down = true;
+		if (in_slot)
+		{
+			// the slot can only be ended from the callback, get back into it through TIMER0
+			nrf_timer_task_trigger(NRF_TIMER0, NRF_TIMER_TASK_CAPTURE1);
+			nrf_timer_cc_set(NRF_TIMER0, NRF_TIMER_CC_CHANNEL0,
+							 nrf_timer_cc_get(NRF_TIMER0, NRF_TIMER_CC_CHANNEL1) + SLOT_END_NOW_US);
+		}
+
+		if (app_cb)
+		{
+			app_cb(TIMESLOT_EVT_END);
+		}
+		k_sem_give(&slot_ended_sem);
+	}
+	if (evts & PENDING_REQUEST)
+	{
+		mpsl_work_submit(&request_work);
+	}
+}
+
+static void timeslot_notify(atomic_val_t evts)
+{
+	atomic_or(&pending_evts, evts);
+	NVIC_SetPendingIRQ(TIMESLOT_SWI_IRQn);
+}
+
+// zero latency irq context: esb keeps running until the swi has torn it down
+static void slot_end(void)
+{
+	if (!ending)
+	{
+		ending = true;
+		timeslot_notify(BIT(TIMESLOT_EVT_END));
+	}
+}
+
+// MPSL zero latency irq context: no kernel calls, everything else goes through the SWI
+static mpsl_timeslot_signal_return_param_t *mpsl_timeslot_cb(mpsl_timeslot_session_id_t id, uint32_t signal)
+{
+	signal_return.callback_action = MPSL_TIMESLOT_SIGNAL_ACTION_NONE;
+
+	switch (signal)
+	{
+	case MPSL_TIMESLOT_SIGNAL_START:
+		// TIMER0 is started by MPSL at 0 for every slot, fire a bit before it runs out
+		slot_end_us = slot_cfg.length_us;
+		nrf_timer_int_enable(NRF_TIMER0, NRF_TIMER_INT_COMPARE0_MASK);
+		nrf_timer_cc_set(NRF_TIMER0, NRF_TIMER_CC_CHANNEL0, slot_end_us - SLOT_END_MARGIN_US);
+		ending = false;
+		torn_down = false;
+		extend_failed = false;
+		in_slot = true;
+		atomic_inc(&slots_started);
+		timeslot_notify(BIT(TIMESLOT_EVT_START));
+		break;
+
+	case MPSL_TIMESLOT_SIGNAL_TIMER0:
+		nrf_timer_event_clear(NRF_TIMER0, NRF_TIMER_EVENT_COMPARE0);
+
+		if (!torn_down)
+		{
+			if (slot_cfg.interval_us == 0 && !end_requested && !ending)
+			{
+				// continuous: try to stretch the slot, the compare moves on once MPSL says yes
+				signal_return.callback_action = MPSL_TIMESLOT_SIGNAL_ACTION_EXTEND;
+				signal_return.params.extend.length_us = slot_cfg.length_us;
+				break;
+			}
+
+			// the swi tears esb down and pulls the compare in again
+			slot_end();
+			break;
+		}
+
+		nrf_timer_int_disable(NRF_TIMER0, NRF_TIMER_INT_COMPARE0_MASK);
+		in_slot = false;
+		if (end_requested)
+		{
+			signal_return.callback_action = MPSL_TIMESLOT_SIGNAL_ACTION_END;
+		}
+		else if (extend_failed)
+		{
+			signal_return.callback_action = MPSL_TIMESLOT_SIGNAL_ACTION_END;
+			timeslot_notify(PENDING_REQUEST);
+		}
+		else
+		{
+			signal_return.callback_action = MPSL_TIMESLOT_SIGNAL_ACTION_REQUEST;
+			signal_return.params.request.p_next = &req_next;
+		}
+		break;
+
+	case MPSL_TIMESLOT_SIGNAL_EXTEND_SUCCEEDED:
+		slot_end_us += slot_cfg.length_us;
+		if (!end_requested && !ending)
+		{
+			// timeslot_close() already pulled the compare in, pushing it out again would outlive its wait
+			nrf_timer_cc_set(NRF_TIMER0, NRF_TIMER_CC_CHANNEL0, slot_end_us - SLOT_END_MARGIN_US);
+		}
+		break;
+
+	case MPSL_TIMESLOT_SIGNAL_EXTEND_FAILED:
+		// BLE needs the radio (or the 128 s limit is up), hand it over and queue up again.
+		// the slot still has SLOT_END_MARGIN_US left, the TIMER0 signal after the teardown ends it
+		extend_failed = true;
+		slot_end();
+		atomic_inc(&slots_blocked);
+		break;
+
+	case MPSL_TIMESLOT_SIGNAL_BLOCKED:
+	case MPSL_TIMESLOT_SIGNAL_CANCELLED:
+		atomic_inc(&slots_blocked);
+		timeslot_notify(PENDING_REQUEST);
+		break;
+
+	case MPSL_TIMESLOT_SIGNAL_SESSION_CLOSED:
+		// closed with the slot still running (timeslot_close() gave up waiting): mpsl takes the radio
+		// and TIMER0 back now, the swi only tears esb down
+		if (in_slot)
+		{
+			nrf_timer_int_disable(NRF_TIMER0, NRF_TIMER_INT_COMPARE0_MASK);
+			in_slot = false;
+			slot_end();
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return &signal_return;
+}
+
+int timeslot_open(const struct timeslot_cfg *cfg, timeslot_cb_t cb)
+{
+	int32_t err;
+
+	if (session_open)
+	{
+		return -EALREADY;
+	}
+
+	slot_cfg = *cfg;
+	app_cb = cb;
+	end_requested = false;
+	req_earliest.params.earliest.length_us = cfg->length_us;
+	req_next.params.normal.length_us = cfg->length_us;
+	req_next.params.normal.distance_us = cfg->interval_us;
+
+	IRQ_CONNECT(TIMESLOT_SWI_IRQn, TIMESLOT_SWI_PRIORITY, timeslot_swi_isr, NULL, 0);
+	irq_enable(TIMESLOT_SWI_IRQn);
+
+	err = mpsl_timeslot_session_open(mpsl_timeslot_cb, &session_id);
+	if (err)
+	{
+		LOG_ERR("Timeslot session open failed, err %d", err);
+		return err;
+	}
+	session_open = true;
+
+	err = mpsl_timeslot_request(session_id, &req_earliest);
+	if (err)
+	{
+		LOG_ERR("Timeslot request failed, err %d", err);
+		timeslot_close();
+	}
+
+	return err;
+}
+
+int timeslot_close(void)
+{
+	if (!session_open)
+	{
+		return -EALREADY;
+	}
+
+	bool ended = true;
+
+	k_sem_reset(&slot_ended_sem);
+	end_requested = true;
+	if (in_slot)
+	{
+		// pull the end of the slot in, the TIMER0 signal does the rest
+		nrf_timer_task_trigger(NRF_TIMER0, NRF_TIMER_TASK_CAPTURE1);
+		nrf_timer_cc_set(NRF_TIMER0, NRF_TIMER_CC_CHANNEL0,
+						 nrf_timer_cc_get(NRF_TIMER0, NRF_TIMER_CC_CHANNEL1) + SLOT_END_NOW_US);
+		ended = k_sem_take(&slot_ended_sem, K_MSEC(10)) == 0;
+		if (!ended)
+		{
+			LOG_WRN("Slot didn't end on time, closing the session ends it");
+		}
+	}
+
+	session_open = false;
+	int32_t err = mpsl_timeslot_session_close(session_id);
+
+	if (!ended)
+	{
+		// SESSION_CLOSED runs slot_end(), the end event comes through the swi as usual
+		k_sem_take(&slot_ended_sem, K_MSEC(10));
+	}
+
+	return err;
+}
+
+void timeslot_stats_get(struct timeslot_stats *stats)
+{
+	stats->started = atomic_clear(&slots_started);
+	stats->blocked = atomic_clear(&slots_blocked);
+}
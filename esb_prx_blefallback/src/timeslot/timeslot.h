@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef TIMESLOT_H_
+#define TIMESLOT_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+
+/* Radio time for ESB next to an enabled BLE stack. Opens a MPSL timeslot session and asks
+ * for slots of cfg.length_us, either every cfg.interval_us or (interval 0) one slot that
+ * keeps extending itself for as long as MPSL grants it. For the length of each slot the
+ * RADIO irq belongs to ESB, right before the slot ends ESB is disabled (from the SWI) and
+ * the irq goes back to MPSL.
+ */
+
+enum timeslot_evt
+{
+	TIMESLOT_EVT_START, // radio is ours, bring ESB up
+	TIMESLOT_EVT_END,	// ESB was disabled, the radio goes back to MPSL right after
+};
+
+// called at normal irq priority (a SWI), never from the MPSL zero latency context
+typedef void (*timeslot_cb_t)(enum timeslot_evt evt);
+
+struct timeslot_cfg
+{
+	uint32_t length_us;	  // slot, or extension step with interval 0. 1000 to 100000.
+	uint32_t interval_us; // start to start, 0 for one continuous slot
+};
+
+struct timeslot_stats
+{
+	uint32_t started;
+	uint32_t blocked; // blocked, cancelled or not extended because of higher priority MPSL activity (BLE)
+};
+
+int timeslot_open(const struct timeslot_cfg *cfg, timeslot_cb_t cb);
+// ends a running slot (TIMESLOT_EVT_END is delivered before this returns) and closes the session
+int timeslot_close(void);
+
+// copy + clear
+void timeslot_stats_get(struct timeslot_stats *stats);
+
+#endif /* TIMESLOT_H_ */
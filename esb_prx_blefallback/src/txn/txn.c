@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include "esb_proto.h"
+#include "txn.h"
+#include "../uplink/uplink.h"
+
+static txn_handler_t txn_handler;
+static uint8_t rsp_buf[ESB_PROTO_MAX_BODY_LEN];
+
+void txn_set_handler(txn_handler_t handler)
+{
+	txn_handler = handler;
+}
+
+void txn_on_rx(const struct esb_payload *rx)
+{
+	const struct esb_proto_hdr *hdr = (const struct esb_proto_hdr *)rx->data;
+
+	if (rx->length < ESB_PROTO_HDR_LEN || hdr->type != ESB_PROTO_TXN_REQ || txn_handler == NULL)
+	{
+		return;
+	}
+
+	uint8_t len = txn_handler(&rx->data[ESB_PROTO_HDR_LEN], rx->length - ESB_PROTO_HDR_LEN, rsp_buf, sizeof(rsp_buf));
+
+	(void)uplink_respond(ESB_PROTO_TXN_RSP, hdr->id, rsp_buf, MIN(len, sizeof(rsp_buf)));
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef TXN_H_
+#define TXN_H_
+
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* PRX side of the request/response transactions. When a request lands the handler is
+ * called straight from the esb callback and its response replaces the queued ack
+ * payloads, so the PTX pickup sent right behind the request collects it.
+ */
+
+// esb irq context, keep it short. returns the response length (<= rsp_max).
+typedef uint8_t (*txn_handler_t)(const uint8_t *req, uint8_t req_len, uint8_t *rsp, uint8_t rsp_max);
+
+void txn_set_handler(txn_handler_t handler);
+
+// esb irq context, call with every received packet
+void txn_on_rx(const struct esb_payload *rx);
+
+#endif /* TXN_H_ */
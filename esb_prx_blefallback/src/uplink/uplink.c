@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/timing/timing.h>
+
+#include "esb_frame.h"
+#include "esb_proto.h"
+#include "link_stats.h"
+#include "uplink.h"
+
+LOG_MODULE_REGISTER(uplink);
+
+#define ACK_FIFO_DEPTH CONFIG_ESB_PRX_ACK_FIFO_DEPTH
+#define SHADOW_LEN MAX(ACK_FIFO_DEPTH, 2) // a transaction response can need placeholder + response
+
+struct uplink_sample
+{
+	timing_t time; // when the application queued it
+	uint8_t len;
+	uint8_t data[UPLINK_SAMPLE_MAX_LEN];
+};
+
+BUILD_ASSERT(UPLINK_SAMPLE_MAX_LEN <= ESB_FRAME_MAX_REC_LEN, "a sample must fit an empty ack payload");
+
+K_MSGQ_DEFINE(uplink_msgq, sizeof(struct uplink_sample), CONFIG_ESB_PRX_UPLINK_QUEUE_LEN, 4);
+
+/* Shadow of our payloads in the ESB TX FIFO, oldest first. The PRX keeps sending the
+ * front entry as ack payload until the next new packet from the PTX, that's when esb
+ * pops it and raises TX_SUCCESS.
+ */
+struct fifo_entry
+{
+	timing_t sample_time; // oldest record in the payload
+	timing_t sent_time;
+	uint8_t records;
+	bool sent;
+	bool is_sample; // false for transaction responses and placeholders, no age stats for those
+};
+
+static struct fifo_entry in_fifo[SHADOW_LEN];
+static uint8_t fifo_head;
+static uint8_t fifo_count;
+
+static struct esb_payload ack_payload;
+static uint8_t uplink_pipe;
+static bool uplink_active; // esb is up and takes payloads, samples just queue up otherwise
+static uint8_t sample_seq;
+
+// bulk transfer in progress, takes the ack payloads over from the samples until it's all queued
+static const uint8_t *bulk_data;
+static uint32_t bulk_len;
+static uint32_t bulk_offset;
+static uint8_t bulk_seq;
+
+// stats, esb irq context except stale_dropped
+static uint32_t acks_sent;
+static uint32_t records_sent;
+static uint32_t fifo_empty;
+static atomic_t stale_dropped;
+static uint32_t age_samples; // sample acks in age_sum_cyc, acks_sent also counts the others
+static uint64_t age_sum_cyc;
+static uint64_t age_max_cyc;
+
+void uplink_init(uint8_t pipe)
+{
+	uplink_pipe = pipe;
+	uplink_reset();
+	uplink_active = true;
+}
+
+void uplink_stop(void)
+{
+	unsigned int key = irq_lock();
+
+	uplink_active = false;
+	uplink_reset();
+	irq_unlock(key);
+}
+
+int uplink_put(const uint8_t *data, uint8_t len)
+{
+	struct uplink_sample sample = {
+		.time = timing_counter_get(),
+		.len = MIN(len, UPLINK_SAMPLE_MAX_LEN),
+	};
+
+	if (len == 0)
+	{
+		return -EINVAL; // a zero length record ends the frame
+	}
+
+	memcpy(sample.data, data, sample.len);
+
+	// newest data wins, push the oldest sample out if the ptx isn't keeping up
+	while (k_msgq_put(&uplink_msgq, &sample, K_NO_WAIT) != 0)
+	{
+		struct uplink_sample stale;
+
+		if (k_msgq_get(&uplink_msgq, &stale, K_NO_WAIT) == 0)
+		{
+			atomic_inc(&stale_dropped);
+		}
+	}
+
+	// the fifo may have run dry since the last poll, don't wait for the next esb event
+	unsigned int key = irq_lock();
+	uplink_refill();
+	irq_unlock(key);
+
+	return 0;
+}
+
+// esb irq context (or irq locked). ack_payload is built already.
+static int fifo_write(timing_t sample_time, uint8_t records)
+{
+	ack_payload.pipe = uplink_pipe;
+
+	int err = esb_write_payload(&ack_payload);
+	if (err)
+	{
+		return err; // esb fifo full or esb not running
+	}
+
+	struct fifo_entry *entry = &in_fifo[(fifo_head + fifo_count) % SHADOW_LEN];
+
+	entry->sample_time = sample_time;
+	entry->records = records;
+	entry->sent = false;
+	entry->is_sample = records > 0;
+	fifo_count++;
+
+	return 0;
+}
+
+static int fifo_push(uint8_t type, uint8_t id, const uint8_t *body, uint8_t len)
+{
+	struct esb_proto_hdr *hdr = (struct esb_proto_hdr *)ack_payload.data;
+
+	hdr->type = type;
+	hdr->id = id;
+	ack_payload.length = ESB_PROTO_HDR_LEN + len;
+	if (len)
+	{
+		memcpy(&ack_payload.data[ESB_PROTO_HDR_LEN], body, len);
+	}
+
+	return fifo_write(timing_counter_get(), 0);
+}
+
+// esb irq context (or irq locked)
+static bool bulk_refill(void)
+{
+	struct esb_proto_hdr *hdr = (struct esb_proto_hdr *)ack_payload.data;
+	struct esb_proto_bulk *bulk = (struct esb_proto_bulk *)&ack_payload.data[ESB_PROTO_HDR_LEN];
+
+	while (bulk_data && fifo_count < ACK_FIFO_DEPTH)
+	{
+		uint32_t chunk = MIN(bulk_len - bulk_offset, ESB_PROTO_BULK_MAX_CHUNK);
+
+		hdr->type = ESB_PROTO_BULK_DATA;
+		hdr->id = bulk_seq;
+		bulk->total = sys_cpu_to_le32(bulk_len);
+		bulk->offset = sys_cpu_to_le32(bulk_offset);
+		memcpy(&ack_payload.data[ESB_PROTO_HDR_LEN + sizeof(*bulk)], &bulk_data[bulk_offset], chunk);
+		ack_payload.length = ESB_PROTO_HDR_LEN + sizeof(*bulk) + chunk;
+
+		if (fifo_write(timing_counter_get(), 0))
+		{
+			break; // rest goes in on the next refill
+		}
+
+		bulk_seq++;
+		bulk_offset += chunk;
+		if (bulk_offset >= bulk_len)
+		{
+			bulk_data = NULL; // all queued, the samples take over again once it's on air
+		}
+	}
+
+	return bulk_data != NULL;
+}
+
+void uplink_refill(void)
+{
+	struct uplink_sample sample;
+
+	if (!uplink_active || bulk_refill())
+	{
+		return;
+	}
+
+	while (fifo_count < ACK_FIFO_DEPTH && k_msgq_peek(&uplink_msgq, &sample) == 0)
+	{
+		timing_t oldest = sample.time;
+		uint8_t records = 0;
+
+		// pack as many queued samples as fit, the per packet overhead is paid once
+		esb_frame_init(&ack_payload, sample_seq);
+		while (k_msgq_peek(&uplink_msgq, &sample) == 0 && esb_frame_put(&ack_payload, sample.data, sample.len))
+		{
+			k_msgq_get(&uplink_msgq, &sample, K_NO_WAIT);
+			records++;
+		}
+
+		if (fifo_write(oldest, records))
+		{
+			atomic_add(&stale_dropped, records);
+			break;
+		}
+		sample_seq++;
+	}
+}
+
+int uplink_respond(uint8_t type, uint8_t id, const uint8_t *body, uint8_t len)
+{
+	// the front payload already went out with the ack to this packet. esb still counts it as
+	// in flight and pops whatever is at the front when the next packet arrives, so keep a
+	// placeholder there or the response gets dropped without ever being sent.
+	bool in_flight = fifo_count > 0 && in_fifo[fifo_head].sent;
+	int err;
+
+	esb_flush_tx();
+	uplink_reset();
+
+	if (in_flight)
+	{
+		err = fifo_push(ESB_PROTO_PLACEHOLDER, 0, NULL, 0);
+		if (err)
+		{
+			return err;
+		}
+		in_fifo[fifo_head].sent = true;
+	}
+
+	return fifo_push(type, id, body, len);
+}
+
+int uplink_bulk_start(const uint8_t *data, uint32_t len, uint32_t offset)
+{
+	// same as a transaction response: replace what's queued, keep the in flight front
+	bool in_flight = fifo_count > 0 && in_fifo[fifo_head].sent;
+
+	if (len == 0 || offset >= len)
+	{
+		return -EINVAL;
+	}
+
+	esb_flush_tx();
+	uplink_reset();
+
+	if (in_flight)
+	{
+		int err = fifo_push(ESB_PROTO_PLACEHOLDER, 0, NULL, 0);
+		if (err)
+		{
+			return err;
+		}
+		in_fifo[fifo_head].sent = true;
+	}
+
+	bulk_data = data;
+	bulk_len = len;
+	bulk_offset = offset;
+	bulk_seq = 0;
+	bulk_refill();
+
+	return 0;
+}
+
+void uplink_on_tx_success(void)
+{
+	if (fifo_count == 0)
+	{
+		return;
+	}
+
+	struct fifo_entry *entry = &in_fifo[fifo_head];
+
+	if (entry->sent && entry->is_sample)
+	{
+		uint64_t age = timing_cycles_get(&entry->sample_time, &entry->sent_time);
+
+		age_samples++;
+		age_sum_cyc += age;
+		age_max_cyc = MAX(age_max_cyc, age);
+	}
+
+	fifo_head = (fifo_head + 1) % SHADOW_LEN;
+	fifo_count--;
+	acks_sent++;
+	records_sent += entry->records;
+}
+
+void uplink_on_rx(void)
+{
+	// whatever is at the front now went out as the ack for this packet
+	if (fifo_count == 0)
+	{
+		fifo_empty++;
+		link_stats_empty_ack(0);
+	}
+	else if (!in_fifo[fifo_head].sent)
+	{
+		in_fifo[fifo_head].sent = true;
+		in_fifo[fifo_head].sent_time = timing_counter_get();
+	}
+
+	uplink_refill();
+}
+
+void uplink_reset(void)
+{
+	unsigned int key = irq_lock();
+
+	fifo_head = 0;
+	fifo_count = 0;
+	bulk_data = NULL; // fragments were flushed with the rest, the ptx sees the gap
+	irq_unlock(key);
+}
+
+void uplink_stats_get(struct uplink_stats *stats)
+{
+	unsigned int key = irq_lock();
+
+	stats->acks_sent = acks_sent;
+	stats->records_sent = records_sent;
+	stats->fifo_empty = fifo_empty;
+	stats->age_avg_us = age_samples ? (uint32_t)(timing_cycles_to_ns(age_sum_cyc / age_samples) / NSEC_PER_USEC) : 0;
+	stats->age_max_us = (uint32_t)(timing_cycles_to_ns(age_max_cyc) / NSEC_PER_USEC);
+	acks_sent = 0;
+	records_sent = 0;
+	fifo_empty = 0;
+	age_samples = 0;
+	age_sum_cyc = 0;
+	age_max_cyc = 0;
+	irq_unlock(key);
+
+	stats->stale_dropped = atomic_clear(&stale_dropped);
+}
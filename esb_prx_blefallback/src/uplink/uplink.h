@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef UPLINK_H_
+#define UPLINK_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* PRX -> PTX data path. The application queues samples with uplink_put(), the esb
+ * callback keeps the ESB TX FIFO topped up with them as ACK payloads, so every poll
+ * from the PTX picks up data instead of an empty ack. Each ack payload carries as many
+ * queued samples as fit, one record each (see esb_frame.h).
+ */
+
+// sample as queued by the application, one record on air
+#define UPLINK_SAMPLE_MAX_LEN 8
+
+struct uplink_stats
+{
+	uint32_t acks_sent;		// ack payloads the ptx confirmed (TX_SUCCESS)
+	uint32_t records_sent;	// samples in them
+	uint32_t stale_dropped; // samples pushed out of the app queue before they went on air
+	uint32_t fifo_empty;	// polls that found nothing to send
+	uint32_t age_avg_us;	// sample age when it went on air
+	uint32_t age_max_us;
+};
+
+// after esb_init(), payloads go to the ESB TX FIFO from here on
+void uplink_init(uint8_t pipe);
+// esb disabled, leave samples queued until the next uplink_init()
+void uplink_stop(void);
+
+// application side, any thread. keeps the newest samples: drops the oldest when the queue is full.
+int uplink_put(const uint8_t *data, uint8_t len);
+
+// esb side. refill tops the ESB TX FIFO up to CONFIG_ESB_PRX_ACK_FIFO_DEPTH.
+void uplink_refill(void);
+
+// esb irq context: replace what's queued with a response so it goes out with the very next ack
+int uplink_respond(uint8_t type, uint8_t id, const uint8_t *body, uint8_t len);
+// esb irq context: send len bytes of data as bulk fragments in the following acks, starting at
+// offset (a ptx resuming after a lost fragment). data must stay valid until it's all queued.
+// Samples wait (and age out) meanwhile.
+int uplink_bulk_start(const uint8_t *data, uint32_t len, uint32_t offset);
+void uplink_on_tx_success(void);
+void uplink_on_rx(void);
+
+// forget what was in the ESB TX FIFO, call after esb_init()/esb_flush_tx()
+void uplink_reset(void);
+
+// copy + clear the stats
+void uplink_stats_get(struct uplink_stats *stats);
+
+#endif /* UPLINK_H_ */
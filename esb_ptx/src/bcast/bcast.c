@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include "bcast.h"
+#include "esb_common.h"
+#include "esb_frame.h"
+#include "esb_proto.h"
+
+LOG_MODULE_REGISTER(bcast);
+
+BUILD_ASSERT(CONFIG_ESB_PTX_NUM_PRX <= ESB_COMMON_BCAST_PIPE, "the broadcast pipe can't be a node's pipe too");
+
+static K_MUTEX_DEFINE(bcast_lock); // one sender at a time
+static struct esb_payload frame;
+static uint8_t seq;
+static atomic_t copies_left; // set last, the poll loop only reads the frame while it's > 0
+static bool spacing;		 // poll loop only: a regular poll goes out before the next copy
+
+int bcast_send(const uint8_t *data, uint8_t len, uint8_t repeats)
+{
+	struct esb_proto_hdr *hdr = (struct esb_proto_hdr *)frame.data;
+	int err = 0;
+
+	if (len == 0 || len > ESB_FRAME_MAX_REC_LEN)
+	{
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&bcast_lock, K_FOREVER);
+	if (atomic_get(&copies_left) > 0)
+	{
+		err = -EBUSY;
+	}
+	else
+	{
+		esb_frame_init(&frame, ++seq);
+		hdr->type = ESB_PROTO_BCAST;
+		esb_frame_put(&frame, data, len);
+		frame.pipe = ESB_COMMON_BCAST_PIPE;
+		frame.noack = true;
+		atomic_set(&copies_left, 1 + repeats);
+	}
+	k_mutex_unlock(&bcast_lock);
+
+	return err;
+}
+
+const struct esb_payload *bcast_next(void)
+{
+	if (atomic_get(&copies_left) <= 0)
+	{
+		spacing = false;
+		return NULL;
+	}
+
+	if (spacing)
+	{
+		spacing = false;
+		return NULL;
+	}
+
+	spacing = true;
+	atomic_dec(&copies_left); // esb_write_payload() copies it before anyone can reuse the frame
+	return &frame;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_bcast(const struct shell *sh, size_t argc, char **argv)
+{
+	uint8_t data[ESB_FRAME_MAX_REC_LEN];
+	size_t len = hex2bin(argv[1], strlen(argv[1]), data, sizeof(data));
+	uint8_t repeats = argc > 2 ? strtoul(argv[2], NULL, 0) : CONFIG_ESB_PTX_BCAST_REPEATS;
+
+	if (len == 0)
+	{
+		shell_error(sh, "record must be hex, e.g. 0102a0");
+		return -EINVAL;
+	}
+
+	int err = bcast_send(data, len, repeats);
+	if (err)
+	{
+		shell_error(sh, "broadcast failed, err %d", err);
+		return err;
+	}
+
+	shell_print(sh, "broadcast %u queued, %u copies", seq, 1 + repeats);
+	return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(bcast, NULL, "<record hex> [repeats], send a record to every node at once", cmd_bcast, 2, 1);
+#endif
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef BCAST_H_
+#define BCAST_H_
+
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* Fleet-wide broadcasts on the shared channel. One record goes out as an ESB_PROTO_BCAST
+ * frame on ESB_COMMON_BCAST_PIPE with noack set, every PRX hears the same transmission.
+ * There is no ack to retry on, so the frame is sent 1 + repeats times with the same
+ * sequence number (the PRXs drop the duplicates), one regular poll in between each so a
+ * burst of interference doesn't take out all copies.
+ */
+
+// any thread. -EBUSY while the last broadcast still has copies to send, -EINVAL for a bad length.
+int bcast_send(const uint8_t *data, uint8_t len, uint8_t repeats);
+
+// poll loop: the frame to send in place of the next poll, NULL if none is due
+const struct esb_payload *bcast_next(void);
+
+#endif /* BCAST_H_ */
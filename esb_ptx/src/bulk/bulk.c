@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/timing/timing.h>
+
+#include "esb_proto.h"
+#include "bulk.h"
+
+LOG_MODULE_REGISTER(bulk);
+
+enum bulk_state
+{
+	BULK_IDLE,
+	BULK_REQ_PENDING, // next poll of the node carries the request
+	BULK_REQ_SENT,
+	BULK_RECEIVING,
+};
+
+static volatile enum bulk_state state = BULK_IDLE;
+static K_MUTEX_DEFINE(bulk_lock); // one caller at a time
+static K_SEM_DEFINE(bulk_done_sem, 0, 1);
+
+static int bulk_node;
+static uint8_t bulk_object;
+static uint8_t bulk_req_id;
+static uint8_t bulk_resumes; // requests from rx_len in a row without a fragment getting through
+
+// filled in by the esb callback
+static uint8_t *rx_buf;
+static uint32_t rx_buf_len;
+static uint32_t rx_len;
+static int bulk_result;
+static timing_t start_time;
+static uint64_t elapsed_cyc;
+
+// esb irq context (or irq locked)
+static void bulk_finish(int result)
+{
+	timing_t end_time = timing_counter_get();
+
+	elapsed_cyc = timing_cycles_get(&start_time, &end_time);
+	bulk_result = result;
+	state = BULK_IDLE;
+	k_sem_give(&bulk_done_sem);
+}
+
+static void bulk_on_fragment(const struct esb_payload *ack)
+{
+	const struct esb_proto_hdr *hdr = (const struct esb_proto_hdr *)ack->data;
+	const struct esb_proto_bulk *bulk = (const struct esb_proto_bulk *)&ack->data[ESB_PROTO_HDR_LEN];
+
+	if (ack->length < ESB_PROTO_HDR_LEN + sizeof(*bulk) || hdr->type != ESB_PROTO_BULK_DATA)
+	{
+		return; // sample queued before the request, the fragments follow
+	}
+
+	uint32_t total = sys_le32_to_cpu(bulk->total);
+	uint32_t offset = sys_le32_to_cpu(bulk->offset);
+	uint32_t chunk = ack->length - ESB_PROTO_HDR_LEN - sizeof(*bulk);
+
+	if (total == 0)
+	{
+		bulk_finish(-ENOENT); // node has no such object
+		return;
+	}
+	if (offset < rx_len)
+	{
+		return; // already have it
+	}
+	if (offset > rx_len)
+	{
+		// an ack got lost, ask again from what we have
+		if (bulk_resumes++ >= CONFIG_ESB_PTX_BULK_RESUME_RETRIES)
+		{
+			bulk_finish(-EIO);
+			return;
+		}
+		state = BULK_REQ_PENDING;
+		return;
+	}
+	if (total > rx_buf_len)
+	{
+		bulk_finish(-ENOMEM);
+		return;
+	}
+
+	memcpy(&rx_buf[offset], &ack->data[ESB_PROTO_HDR_LEN + sizeof(*bulk)], MIN(chunk, total - offset));
+	rx_len = MIN(offset + chunk, total);
+	bulk_resumes = 0;
+	if (rx_len == total)
+	{
+		bulk_finish(total);
+	}
+}
+
+void bulk_on_tx_result(int node_id, bool success, const struct esb_payload *ack)
+{
+	if (node_id != bulk_node)
+	{
+		return;
+	}
+
+	switch (state)
+	{
+	case BULK_REQ_SENT:
+		// the ack to the request itself is still from before it, fragments start with the next poll
+		state = success ? BULK_RECEIVING : BULK_REQ_PENDING;
+		break;
+
+	case BULK_RECEIVING:
+		if (success && ack)
+		{
+			bulk_on_fragment(ack);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void bulk_abort(int node_id, int err)
+{
+	unsigned int key = irq_lock();
+
+	if (state != BULK_IDLE && node_id == bulk_node)
+	{
+		bulk_finish(err);
+	}
+	irq_unlock(key);
+}
+
+int bulk_active_node(void)
+{
+	return state == BULK_IDLE ? -1 : bulk_node;
+}
+
+bool bulk_build_request(int node_id, struct esb_payload *payload)
+{
+	struct esb_proto_hdr *hdr = (struct esb_proto_hdr *)payload->data;
+
+	if (state != BULK_REQ_PENDING || node_id != bulk_node)
+	{
+		return false;
+	}
+
+	hdr->type = ESB_PROTO_BULK_REQ;
+	hdr->id = ++bulk_req_id;
+	payload->data[ESB_PROTO_HDR_LEN] = bulk_object;
+	sys_put_le32(rx_len, &payload->data[ESB_PROTO_HDR_LEN + 1]); // 0, or where a lost fragment left us
+	payload->length = ESB_PROTO_HDR_LEN + 1 + sizeof(uint32_t);
+	state = BULK_REQ_SENT; // before the write, the tx event can beat us back
+
+	return true;
+}
+
+int bulk_get(int node_id, uint8_t object, uint8_t *buf, uint32_t buf_len, uint32_t *elapsed_us,
+			 k_timeout_t timeout)
+{
+	int result;
+
+	k_mutex_lock(&bulk_lock, K_FOREVER);
+
+	rx_buf = buf;
+	rx_buf_len = buf_len;
+	rx_len = 0;
+	bulk_resumes = 0;
+	bulk_node = node_id;
+	bulk_object = object;
+	start_time = timing_counter_get();
+	k_sem_reset(&bulk_done_sem);
+	state = BULK_REQ_PENDING;
+
+	if (k_sem_take(&bulk_done_sem, timeout))
+	{
+		unsigned int key = irq_lock();
+		bool finished = state == BULK_IDLE && k_sem_count_get(&bulk_done_sem);
+
+		// the node keeps queueing fragments until it's through, they get ignored from here on
+		state = BULK_IDLE;
+		irq_unlock(key);
+
+		if (!finished)
+		{
+			k_mutex_unlock(&bulk_lock);
+			return -ETIMEDOUT;
+		}
+	}
+
+	result = bulk_result;
+	if (result >= 0 && elapsed_us)
+	{
+		*elapsed_us = (uint32_t)(timing_cycles_to_ns(elapsed_cyc) / NSEC_PER_USEC);
+	}
+
+	k_mutex_unlock(&bulk_lock);
+	return result;
+}
+
+#if defined(CONFIG_SHELL)
+static uint8_t shell_buf[CONFIG_ESB_PTX_BULK_SHELL_BUF_SIZE];
+
+static int cmd_bulk(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t elapsed_us = 0;
+	uint8_t object = argc > 2 ? strtoul(argv[2], NULL, 0) : 0;
+
+	int len = bulk_get(strtol(argv[1], NULL, 0), object, shell_buf, sizeof(shell_buf), &elapsed_us, K_SECONDS(10));
+	if (len < 0)
+	{
+		shell_error(sh, "bulk transfer failed, err %d", len);
+		return len;
+	}
+
+	shell_print(sh, "%d bytes in %u us, %u KB/s, crc32 %08x", len, elapsed_us,
+				(uint32_t)((uint64_t)len * USEC_PER_SEC / 1024 / MAX(elapsed_us, 1)), crc32_ieee(shell_buf, len));
+	return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(bulk, NULL, "<node id> [object], pull an object from the node and time it", cmd_bulk, 2, 1);
+#endif
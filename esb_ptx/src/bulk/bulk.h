@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef BULK_H_
+#define BULK_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* Bulk transfers from a node. A ESB_PROTO_BULK_REQ asks the node for an object, it answers
+ * with sequenced fragments in the ack payloads of the following polls and they get
+ * reassembled here from the esb callback. While a transfer runs the poll loop gives the
+ * node CONFIG_ESB_PTX_BULK_BURST polls back to back for every round-robin poll.
+ */
+
+// blocking, one transfer at a time. returns the object length, or -ETIMEDOUT, -ENOMEM (buf too
+// small), -ENOENT (node has no such object), -ENODEV (node removed meanwhile), -EIO (fragment still missing after CONFIG_ESB_PTX_BULK_RESUME_RETRIES requests from
+// the gap). elapsed_us (optional) is request to last fragment.
+int bulk_get(int node_id, uint8_t object, uint8_t *buf, uint32_t buf_len, uint32_t *elapsed_us,
+			 k_timeout_t timeout);
+
+// poll loop side. node the transfer wants polled, -1 if none.
+int bulk_active_node(void);
+// turns the node's poll into the bulk request if one is due, false to poll as usual
+bool bulk_build_request(int node_id, struct esb_payload *payload);
+
+// fail the transfer with err if it is from node_id
+void bulk_abort(int node_id, int err);
+
+// esb callback side, every poll result
+void bulk_on_tx_result(int node_id, bool success, const struct esb_payload *ack);
+
+#endif /* BULK_H_ */
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+#include "esb_frame.h"
+#include "nodes/nodes.h"
+#include "downlink.h"
+
+LOG_MODULE_REGISTER(downlink);
+
+K_MEM_SLAB_DEFINE_STATIC(msg_pool, sizeof(struct downlink_msg), CONFIG_ESB_PTX_DOWNLINK_MSGS, sizeof(void *));
+
+// per node and priority, oldest at the head. zeroed lists are empty, nodes_init() can reset before anything runs here.
+static sys_slist_t queues[NODES_MAX][DOWNLINK_PRIO_COUNT];
+// packed into the last data frame, in payload order. freed on its ack, resent unchanged otherwise.
+static sys_slist_t in_flight[NODES_MAX];
+// data frame sequence number per node, moves on once a frame with records is acked. the prx drops
+// the records of a repeat, one it got before the ack was lost.
+static uint8_t seq[NODES_MAX];
+static struct k_spinlock downlink_lock; // only list links change under it, no payload bytes
+
+struct downlink_msg *downlink_alloc(k_timeout_t timeout)
+{
+	struct downlink_msg *msg;
+
+	if (k_mem_slab_alloc(&msg_pool, (void **)&msg, timeout) != 0)
+	{
+		return NULL;
+	}
+	msg->len = 0;
+	return msg;
+}
+
+void downlink_free(struct downlink_msg *msg)
+{
+	if (msg)
+	{
+		k_mem_slab_free(&msg_pool, msg);
+	}
+}
+
+int downlink_submit(int node, enum downlink_prio prio, struct downlink_msg *msg)
+{
+	if (node < 0 || node >= NODES_MAX || prio >= DOWNLINK_PRIO_COUNT || msg->len == 0 ||
+		msg->len > DOWNLINK_MSG_MAX_LEN)
+	{
+		downlink_free(msg);
+		return -EINVAL;
+	}
+
+	msg->prio = prio;
+
+	k_spinlock_key_t key = k_spin_lock(&downlink_lock);
+	sys_slist_append(&queues[node][prio], &msg->node);
+	k_spin_unlock(&downlink_lock, key);
+
+	return 0;
+}
+
+int downlink_put(int node, const uint8_t *data, uint8_t len)
+{
+	if (len == 0 || len > DOWNLINK_MSG_MAX_LEN)
+	{
+		return -EINVAL;
+	}
+
+	struct downlink_msg *msg = downlink_alloc(K_NO_WAIT);
+	if (!msg)
+	{
+		return -ENOMEM;
+	}
+
+	memcpy(msg->data, data, len);
+	msg->len = len;
+	return downlink_submit(node, DOWNLINK_PRIO_NORMAL, msg);
+}
+
+static void free_list(sys_slist_t *list)
+{
+	sys_snode_t *sn;
+
+	while ((sn = sys_slist_get(list)) != NULL)
+	{
+		k_mem_slab_free(&msg_pool, CONTAINER_OF(sn, struct downlink_msg, node));
+	}
+}
+
+void downlink_pack(int node, struct esb_payload *payload)
+{
+	sys_snode_t *sn;
+
+	if (node < 0 || node >= NODES_MAX)
+	{
+		esb_frame_init(payload, 0);
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&downlink_lock);
+
+	esb_frame_init(payload, seq[node]);
+
+	// an unacked frame goes out again as it was, same records under the same sequence number
+	if (!sys_slist_is_empty(&in_flight[node]))
+	{
+		SYS_SLIST_FOR_EACH_NODE(&in_flight[node], sn)
+		{
+			struct downlink_msg *msg = CONTAINER_OF(sn, struct downlink_msg, node);
+
+			(void)esb_frame_put(payload, msg->data, msg->len); // fit the first time
+		}
+		k_spin_unlock(&downlink_lock, key);
+		return;
+	}
+
+	for (int prio = 0; prio < DOWNLINK_PRIO_COUNT; prio++)
+	{
+		while ((sn = sys_slist_peek_head(&queues[node][prio])) != NULL)
+		{
+			struct downlink_msg *msg = CONTAINER_OF(sn, struct downlink_msg, node);
+
+			if (!esb_frame_put(payload, msg->data, msg->len))
+			{
+				// full, lower priorities wait too so nothing overtakes across polls
+				k_spin_unlock(&downlink_lock, key);
+				return;
+			}
+			sys_slist_get_not_empty(&queues[node][prio]);
+			sys_slist_append(&in_flight[node], sn);
+		}
+	}
+	k_spin_unlock(&downlink_lock, key);
+}
+
+void downlink_on_tx_result(int node, bool success)
+{
+	if (node < 0 || node >= NODES_MAX)
+	{
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&downlink_lock);
+
+	// a failed frame stays in flight, the node's next data poll repeats it
+	if (success && !sys_slist_is_empty(&in_flight[node]))
+	{
+		free_list(&in_flight[node]);
+		seq[node]++;
+	}
+	k_spin_unlock(&downlink_lock, key);
+}
+
+void downlink_reset(int node)
+{
+	if (node < 0 || node >= NODES_MAX)
+	{
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&downlink_lock);
+
+	for (int prio = 0; prio < DOWNLINK_PRIO_COUNT; prio++)
+	{
+		free_list(&queues[node][prio]);
+	}
+	free_list(&in_flight[node]);
+	// not 0 on every (re)add, or a prx that saw the old node's last frame could drop the first one
+	seq[node] = (uint8_t)k_cycle_get_32();
+	k_spin_unlock(&downlink_lock, key);
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_send(const struct shell *sh, size_t argc, char **argv)
+{
+	enum downlink_prio prio = DOWNLINK_PRIO_NORMAL;
+
+	if (argc > 3)
+	{
+		if (strcmp(argv[3], "high") == 0)
+		{
+			prio = DOWNLINK_PRIO_HIGH;
+		}
+		else if (strcmp(argv[3], "low") == 0)
+		{
+			prio = DOWNLINK_PRIO_LOW;
+		}
+		else if (strcmp(argv[3], "normal") != 0)
+		{
+			shell_error(sh, "priority must be high, normal or low");
+			return -EINVAL;
+		}
+	}
+
+	struct downlink_msg *msg = downlink_alloc(K_NO_WAIT);
+	if (!msg)
+	{
+		shell_error(sh, "no free downlink messages");
+		return -ENOMEM;
+	}
+
+	// straight into the pool message, no staging buffer
+	msg->len = hex2bin(argv[2], strlen(argv[2]), msg->data, sizeof(msg->data));
+	if (msg->len == 0)
+	{
+		downlink_free(msg);
+		shell_error(sh, "record must be hex, at most %u bytes, e.g. 0102a0", DOWNLINK_MSG_MAX_LEN);
+		return -EINVAL;
+	}
+
+	int err = downlink_submit(strtol(argv[1], NULL, 0), prio, msg);
+	if (err)
+	{
+		shell_error(sh, "queue failed, err %d", err);
+	}
+
+	return err;
+}
+
+static int cmd_downlink(const struct shell *sh, size_t argc, char **argv)
+{
+	shell_print(sh, "downlink pool: %u of %u messages free", k_mem_slab_num_free_get(&msg_pool),
+				CONFIG_ESB_PTX_DOWNLINK_MSGS);
+	return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(send, NULL, "<node id> <record hex> [high|normal|low], queue a record for the node's next poll", cmd_send, 3, 1);
+SHELL_CMD_REGISTER(downlink, NULL, "downlink message pool usage", cmd_downlink);
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef DOWNLINK_H_
+#define DOWNLINK_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <zephyr/sys/slist.h>
+#include <esb.h>
+
+#include "esb_frame.h"
+
+/* PTX -> PRX data path. Messages are queued per node and priority and ride along with
+ * that node's next polls, as many records per payload as fit (see esb_frame.h): all high
+ * priority ones first, oldest first within a priority.
+ * Messages come from a shared pool (CONFIG_ESB_PTX_DOWNLINK_MSGS). Fill one from
+ * downlink_alloc() in place and hand it over with downlink_submit(), the only copy left
+ * is the poller packing it into the payload. downlink_put() copies for the simple case.
+ * Packed messages stay with the node until the poll is acked. A poll that fails is sent
+ * again unchanged on the node's next data poll, under the same per-node sequence number
+ * in the proto header id, and the PRX drops the records of a frame it already has (its ack
+ * was the one that got lost). So the radio delivers each message once, in order.
+ */
+#define DOWNLINK_MSG_MAX_LEN ESB_FRAME_MAX_REC_LEN // one record, the biggest a poll can carry
+
+enum downlink_prio
+{
+	DOWNLINK_PRIO_HIGH,
+	DOWNLINK_PRIO_NORMAL,
+	DOWNLINK_PRIO_LOW,
+	DOWNLINK_PRIO_COUNT,
+};
+
+struct downlink_msg
+{
+	sys_snode_t node; // queue link, owned by downlink while submitted
+	uint8_t prio; // set by downlink_submit()
+	uint8_t len;
+	uint8_t data[DOWNLINK_MSG_MAX_LEN];
+};
+
+// any thread. NULL when the pool stays empty for the timeout.
+struct downlink_msg *downlink_alloc(k_timeout_t timeout);
+
+// takes the message over, also on error. -EINVAL for a bad node, priority or length.
+int downlink_submit(int node, enum downlink_prio prio, struct downlink_msg *msg);
+
+// a message from downlink_alloc() that won't be submitted after all
+void downlink_free(struct downlink_msg *msg);
+
+// any thread, copies into a normal priority message. -ENOMEM when the pool is empty.
+int downlink_put(int node, const uint8_t *data, uint8_t len);
+
+// poll loop: build the node's data frame, header + as many queued records as fit, or the
+// unacked last one again. in flight until downlink_on_tx_result() for that poll.
+void downlink_pack(int node, struct esb_payload *payload);
+
+// esb callback or poll loop, once per poll: frees the packed records on success, keeps them for a resend otherwise
+void downlink_on_tx_result(int node, bool success);
+
+// drop whatever is queued, node id got (re)assigned
+void downlink_reset(int node);
+
+#endif /* DOWNLINK_H_ */
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <stdlib.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+#include "edf.h"
+#include "nodes/nodes.h"
+
+LOG_MODULE_REGISTER(edf);
+
+#define POLL_COST_US CONFIG_ESB_PTX_EDF_POLL_COST_US
+
+struct edf_node
+{
+	uint32_t period_us;
+	uint32_t deadline_us;
+	int64_t release; // ticks, current poll's release, -1 = release on the next look
+	uint32_t polls;
+	uint32_t misses;
+	uint32_t max_late_us;
+};
+
+static struct edf_node edf_table[NODES_MAX];
+static uint32_t total_misses;
+static struct k_spinlock edf_lock; // shell changes periods while the poll loop schedules
+
+// edf_lock held, per mille of the radio time the periodic nodes can claim
+static uint32_t load_permille(int except)
+{
+	uint32_t load = 0;
+
+	for (int i = 0; i < NODES_MAX; i++)
+	{
+		if (i != except && edf_table[i].period_us)
+		{
+			load += POLL_COST_US * 1000 / edf_table[i].deadline_us;
+		}
+	}
+
+	return load;
+}
+
+int edf_set(int node, uint32_t period_us, uint32_t deadline_us)
+{
+	int err = 0;
+
+	if (node < 0 || node >= NODES_MAX)
+	{
+		return -EINVAL;
+	}
+
+	deadline_us = deadline_us ? deadline_us : period_us;
+	if (deadline_us > period_us || (period_us && deadline_us < POLL_COST_US))
+	{
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&edf_lock);
+	if (period_us && load_permille(node) + POLL_COST_US * 1000 / deadline_us > 1000)
+	{
+		err = -ENOSPC;
+	}
+	else
+	{
+		edf_table[node] = (struct edf_node){
+			.period_us = period_us,
+			.deadline_us = deadline_us,
+			.release = -1,
+		};
+	}
+	k_spin_unlock(&edf_lock, key);
+
+	return err;
+}
+
+void edf_reset(int node)
+{
+	edf_set(node, 0, 0);
+}
+
+// edf_lock held, the node's released poll goes out now
+static void edf_account(struct edf_node *e, int64_t now)
+{
+	int64_t period = k_us_to_ticks_near64(e->period_us);
+	int64_t deadline = k_us_to_ticks_near64(e->deadline_us);
+	int64_t late = now - e->release;
+
+	e->polls++;
+	e->max_late_us = MAX(e->max_late_us, k_ticks_to_us_near32(late));
+	if (late > deadline)
+	{
+		e->misses++;
+		total_misses++;
+	}
+
+	e->release += period;
+	if (e->release + deadline < now)
+	{
+		// fell more than a period behind, drop the polls whose deadline passed instead of rushing them
+		int64_t skipped = (now - e->release - deadline) / period + 1;
+
+		e->misses += skipped;
+		total_misses += skipped;
+		e->release += skipped * period;
+	}
+}
+
+int edf_next(int64_t *wake_ticks)
+{
+	int64_t now = k_uptime_ticks();
+	int64_t best_deadline = INT64_MAX;
+	int best = -EAGAIN;
+
+	// absent nodes come back through their backoff probes, look again by then at the latest
+	*wake_ticks = now + k_ms_to_ticks_ceil64(CONFIG_ESB_PTX_BACKOFF_MIN_MS);
+
+	k_spinlock_key_t key = k_spin_lock(&edf_lock);
+	for (int i = 0; i < NODES_MAX; i++)
+	{
+		struct edf_node *e = &edf_table[i];
+
+		if (!e->period_us)
+		{
+			continue;
+		}
+
+		if (!nodes_due(i))
+		{
+			e->release = -1; // absent, its polls aren't missed, start over once it's back
+			continue;
+		}
+
+		if (e->release < 0)
+		{
+			e->release = now;
+		}
+
+		if (e->release > now)
+		{
+			*wake_ticks = MIN(*wake_ticks, e->release);
+			continue;
+		}
+
+		int64_t deadline = e->release + k_us_to_ticks_near64(e->deadline_us);
+		if (deadline < best_deadline)
+		{
+			best_deadline = deadline;
+			best = i;
+		}
+	}
+
+	if (best >= 0)
+	{
+		edf_account(&edf_table[best], now);
+	}
+	k_spin_unlock(&edf_lock, key);
+
+	return best;
+}
+
+int edf_next_best_effort(int prev)
+{
+	// no lock: period_us is a single word, worst case a node changed class a moment ago
+	for (int i = 1; i <= NODES_MAX; i++)
+	{
+		int id = (prev + i + NODES_MAX) % NODES_MAX;
+
+		if (!edf_table[id].period_us && nodes_due(id))
+		{
+			return id;
+		}
+	}
+
+	return -EAGAIN;
+}
+
+int edf_stats_get(int node, struct edf_node_stats *stats)
+{
+	if (node < 0 || node >= NODES_MAX)
+	{
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&edf_lock);
+	struct edf_node *e = &edf_table[node];
+
+	stats->period_us = e->period_us;
+	stats->deadline_us = e->deadline_us;
+	stats->polls = e->polls;
+	stats->misses = e->misses;
+	stats->max_late_us = e->max_late_us;
+	k_spin_unlock(&edf_lock, key);
+
+	return 0;
+}
+
+uint32_t edf_misses(void)
+{
+	return total_misses;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_edf_set(const struct shell *sh, size_t argc, char **argv)
+{
+	int node = strtol(argv[1], NULL, 0);
+	uint32_t period_us = strtoul(argv[2], NULL, 0);
+	uint32_t deadline_us = argc > 3 ? strtoul(argv[3], NULL, 0) : 0;
+	struct node_cfg cfg;
+
+	if (nodes_get_cfg(node, &cfg))
+	{
+		shell_error(sh, "no node %d", node);
+		return -ENOENT;
+	}
+
+	int err = edf_set(node, period_us, deadline_us);
+	if (err == -ENOSPC)
+	{
+		shell_error(sh, "doesn't fit, %u us per poll would need more than the whole radio", POLL_COST_US);
+	}
+	else if (err)
+	{
+		shell_error(sh, "deadline must be between %u us and the period", POLL_COST_US);
+	}
+
+	return err;
+}
+
+static int cmd_edf_list(const struct shell *sh, size_t argc, char **argv)
+{
+	struct edf_node_stats s;
+	struct node_cfg cfg;
+
+	for (int i = 0; i < NODES_MAX; i++)
+	{
+		if (nodes_get_cfg(i, &cfg) || edf_stats_get(i, &s))
+		{
+			continue;
+		}
+
+		if (!s.period_us)
+		{
+			shell_print(sh, "node %2d: best effort", i);
+			continue;
+		}
+
+		shell_print(sh, "node %2d: period %u us deadline %u us, %u polls, %u missed, worst %u us after release", i,
+					s.period_us, s.deadline_us, s.polls, s.misses, s.max_late_us);
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&edf_lock);
+	uint32_t load = load_permille(-1);
+	k_spin_unlock(&edf_lock, key);
+
+	shell_print(sh, "periodic load %u.%u%%", load / 10, load % 10);
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(edf_cmds,
+							   SHELL_CMD_ARG(set, NULL, "<node id> <period us, 0 = best effort> [deadline us]", cmd_edf_set, 3, 1),
+							   SHELL_CMD_ARG(list, NULL, "periods and deadline misses", cmd_edf_list, 1, 0),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(edf, &edf_cmds, "deadline driven poll schedule", NULL);
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef EDF_H_
+#define EDF_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+
+/* Deadline driven poll order. A node with a period gets a poll released every period_us
+ * that has to be on air within deadline_us of its release, the loop always takes the
+ * released poll with the earliest deadline. Whatever time is left goes to a bulk transfer
+ * and then round-robin to the nodes without a period (best effort, the default).
+ * Periods are admitted while the sum of CONFIG_ESB_PTX_EDF_POLL_COST_US / deadline over all
+ * nodes stays <= 1, so the periodic nodes can't starve each other. Transactions and
+ * broadcasts still jump the queue and eat into that.
+ */
+
+struct edf_node_stats
+{
+	uint32_t period_us; // 0 = best effort
+	uint32_t deadline_us;
+	uint32_t polls;
+	uint32_t misses;	  // polls that went out after their deadline, or were skipped to catch up
+	uint32_t max_late_us; // worst release to poll time
+};
+
+// period_us 0 makes the node best effort, deadline_us 0 means the period.
+// -EINVAL for a bad node or deadline > period, -ENOSPC if the schedule would overload.
+int edf_set(int node, uint32_t period_us, uint32_t deadline_us);
+
+// node id got (re)assigned, back to best effort
+void edf_reset(int node);
+
+// poll loop: released periodic node with the earliest deadline, its poll counts as done.
+// -EAGAIN if none is released, wake_ticks is then when to look again.
+int edf_next(int64_t *wake_ticks);
+
+// poll loop: next best effort node after prev that is due, round-robin. -EAGAIN if none.
+int edf_next_best_effort(int prev);
+
+int edf_stats_get(int node, struct edf_node_stats *stats);
+
+// all nodes, since boot
+uint32_t edf_misses(void);
+
+#endif /* EDF_H_ */
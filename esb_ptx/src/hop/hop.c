@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <stdlib.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+#include "esb_common.h"
+#include "esb_proto.h"
+#include "hop.h"
+#include "nodes/nodes.h"
+
+LOG_MODULE_REGISTER(hop);
+
+#define LOSS_ONE BIT(16)   // Q16, same scale as the retx loss
+#define LOSS_EWMA_SHIFT 4
+#define BLACKLIST_LOSS (LOSS_ONE * CONFIG_ESB_PTX_HOP_BLACKLIST_PERMILLE / 1000)
+#define MIN_SAMPLES 32 // polls on a channel before its loss counts
+
+struct channel_state
+{
+	uint32_t tx_success;
+	uint32_t tx_failed;
+	uint32_t loss;
+	uint32_t samples; // since it was last (un)blacklisted
+	int32_t rssi_sum;
+	uint32_t rssi_count;
+	int64_t blacklisted_until_ms; // 0 = usable
+};
+
+static struct channel_state channels[ESB_COMMON_NUM_HOP_CHANNELS];
+static struct k_spinlock hop_lock; // stats come from the esb callback, the poll loop and shell read them
+static volatile uint8_t target_index; // where the fleet should be
+static int64_t next_hop_ms;
+
+// hop frame on air, and the last acked one for the poll loop to write into the node table
+static volatile int hop_sent_node = -1;
+static uint8_t hop_sent_channel;
+static volatile int hop_acked_node = -1;
+static uint8_t hop_acked_channel;
+
+void hop_on_tx_result(int node, uint8_t channel, bool success, const struct esb_payload *ack)
+{
+	struct node_liveness liveness;
+	int index = esb_common_hop_index(channel);
+
+	if (node == hop_sent_node)
+	{
+		if (success)
+		{
+			hop_acked_channel = hop_sent_channel;
+			hop_acked_node = node;
+		}
+		hop_sent_node = -1; // resent on the next poll if it failed
+		// the node may already be gone to the new channel with a lost ack, that's not this channel's loss
+		return;
+	}
+
+	// an absent node fails on every channel, that says nothing about this one
+	if (index < 0 || nodes_get_liveness(node, &liveness) || liveness.absent)
+	{
+		return;
+	}
+
+	struct channel_state *ch = &channels[index];
+	uint32_t sample = success ? 0 : LOSS_ONE;
+	k_spinlock_key_t key = k_spin_lock(&hop_lock);
+
+	if (success)
+	{
+		ch->tx_success++;
+	}
+	else
+	{
+		ch->tx_failed++;
+	}
+	ch->loss = ch->loss - (ch->loss >> LOSS_EWMA_SHIFT) + (sample >> LOSS_EWMA_SHIFT);
+	ch->samples++;
+	if (ack)
+	{
+		ch->rssi_sum -= ack->rssi; // magnitude, 60 = -60 dBm
+		ch->rssi_count++;
+	}
+	k_spin_unlock(&hop_lock, key);
+}
+
+static bool usable(int index)
+{
+	return channels[index].blacklisted_until_ms == 0;
+}
+
+// hop_lock held. lowest loss among the usable channels, unknown ones count as clean.
+static int best_channel(void)
+{
+	int best = -1;
+
+	for (int i = 1; i <= ESB_COMMON_NUM_HOP_CHANNELS; i++)
+	{
+		int index = (target_index + i) % ESB_COMMON_NUM_HOP_CHANNELS;
+
+		if (usable(index) && (best < 0 || channels[index].loss < channels[best].loss))
+		{
+			best = index;
+		}
+	}
+
+	return best;
+}
+
+// hop_lock held. next usable channel in table order, the regular hop sequence.
+static int next_channel(void)
+{
+	for (int i = 1; i <= ESB_COMMON_NUM_HOP_CHANNELS; i++)
+	{
+		int index = (target_index + i) % ESB_COMMON_NUM_HOP_CHANNELS;
+
+		if (usable(index))
+		{
+			return index;
+		}
+	}
+
+	return -1;
+}
+
+void hop_update(void)
+{
+	int64_t now = k_uptime_get();
+	uint32_t blacklisted = 0;
+	int next = -1;
+
+	if (hop_acked_node >= 0)
+	{
+		unsigned int key = irq_lock();
+		int node = hop_acked_node;
+		uint8_t channel = hop_acked_channel;
+
+		hop_acked_node = -1;
+		irq_unlock(key);
+		nodes_set_channel(node, channel);
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&hop_lock);
+	for (int i = 0; i < ESB_COMMON_NUM_HOP_CHANNELS; i++)
+	{
+		struct channel_state *ch = &channels[i];
+
+		if (ch->blacklisted_until_ms && now >= ch->blacklisted_until_ms)
+		{
+			// on probation: starts clean, goes straight back on the list if it's still bad
+			ch->blacklisted_until_ms = 0;
+			ch->loss = 0;
+			ch->samples = 0;
+		}
+		else if (!ch->blacklisted_until_ms && ch->samples >= MIN_SAMPLES && ch->loss > BLACKLIST_LOSS)
+		{
+			ch->blacklisted_until_ms = now + CONFIG_ESB_PTX_HOP_BLACKLIST_MS;
+			ch->samples = 0;
+			blacklisted |= BIT(i);
+		}
+	}
+
+	if (!usable(target_index))
+	{
+		next = best_channel();
+	}
+	else if (CONFIG_ESB_PTX_HOP_INTERVAL_MS > 0 && now >= next_hop_ms)
+	{
+		next = next_channel();
+		next_hop_ms = now + CONFIG_ESB_PTX_HOP_INTERVAL_MS;
+	}
+
+	uint8_t from = esb_common_hop_channels[target_index];
+	if (next >= 0)
+	{
+		target_index = next;
+	}
+	k_spin_unlock(&hop_lock, key);
+
+	for (int i = 0; i < ESB_COMMON_NUM_HOP_CHANNELS; i++)
+	{
+		if (blacklisted & BIT(i))
+		{
+			LOG_WRN("Channel %u blacklisted for %d ms", esb_common_hop_channels[i], CONFIG_ESB_PTX_HOP_BLACKLIST_MS);
+		}
+	}
+	if (next >= 0 && esb_common_hop_channels[next] != from)
+	{
+		LOG_INF("Hopping from channel %u to %u", from, esb_common_hop_channels[next]);
+	}
+}
+
+bool hop_build_request(int node, struct esb_payload *payload)
+{
+	struct esb_proto_hdr *hdr = (struct esb_proto_hdr *)payload->data;
+	struct node_cfg cfg;
+	uint8_t channel = hop_channel();
+
+	// nodes on a channel of their own (node add <pipe> <ch> off the hop table) stay there
+	if (nodes_get_cfg(node, &cfg) || cfg.channel == channel || esb_common_hop_index(cfg.channel) < 0)
+	{
+		return false;
+	}
+
+	hdr->type = ESB_PROTO_HOP;
+	hdr->id = 0;
+	payload->data[ESB_PROTO_HDR_LEN] = channel;
+	payload->length = ESB_PROTO_HDR_LEN + 1;
+
+	hop_sent_channel = channel;
+	hop_sent_node = node;
+	return true;
+}
+
+uint8_t hop_channel(void)
+{
+	return esb_common_hop_channels[target_index];
+}
+
+int hop_set_channel(uint8_t channel)
+{
+	int index = esb_common_hop_index(channel);
+
+	if (index < 0)
+	{
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&hop_lock);
+	target_index = index;
+	next_hop_ms = k_uptime_get() + CONFIG_ESB_PTX_HOP_INTERVAL_MS;
+	k_spin_unlock(&hop_lock, key);
+
+	return 0;
+}
+
+int hop_get_stats(int index, struct hop_channel_stats *stats)
+{
+	if (index < 0 || index >= ESB_COMMON_NUM_HOP_CHANNELS)
+	{
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&hop_lock);
+	struct channel_state *ch = &channels[index];
+
+	stats->channel = esb_common_hop_channels[index];
+	stats->blacklisted = !usable(index);
+	stats->tx_success = ch->tx_success;
+	stats->tx_failed = ch->tx_failed;
+	stats->loss_permille = (uint32_t)(ch->loss * 1000ULL >> 16);
+	stats->rssi_avg = ch->rssi_count ? ch->rssi_sum / (int32_t)ch->rssi_count : 0;
+	k_spin_unlock(&hop_lock, key);
+
+	return 0;
+}
+
+// or the hopper would start the fleet somewhere else than the node table puts it
+BUILD_ASSERT(ESB_COMMON_IS_HOP_CHANNEL(CONFIG_ESB_PTX_SHARED_RF_CHANNEL),
+			 "CONFIG_ESB_PTX_SHARED_RF_CHANNEL must be one of ESB_COMMON_HOP_CHANNEL_LIST with CONFIG_ESB_PTX_HOP");
+
+static int hop_init(void)
+{
+	// the fleet starts where the node table puts it
+	return hop_set_channel(CONFIG_ESB_PTX_SHARED_RF_CHANNEL);
+}
+
+SYS_INIT(hop_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#if defined(CONFIG_SHELL)
+static int cmd_hop_show(const struct shell *sh, size_t argc, char **argv)
+{
+	struct hop_channel_stats stats;
+
+	shell_print(sh, "fleet on channel %u", hop_channel());
+	shell_print(sh, " ch   tx_ok  tx_fail  loss  rssi");
+	for (int i = 0; hop_get_stats(i, &stats) == 0; i++)
+	{
+		shell_print(sh, "%3u %7u %8u %3u.%u%% %5d%s", stats.channel, stats.tx_success, stats.tx_failed,
+					stats.loss_permille / 10, stats.loss_permille % 10, stats.rssi_avg,
+					stats.blacklisted ? "  blacklisted" : "");
+	}
+
+	return 0;
+}
+
+static int cmd_hop_to(const struct shell *sh, size_t argc, char **argv)
+{
+	int err = hop_set_channel(strtoul(argv[1], NULL, 0));
+
+	if (err)
+	{
+		shell_error(sh, "channel must be one of the hop table");
+	}
+
+	return err;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(hop_cmds,
+							   SHELL_CMD_ARG(show, NULL, "per channel loss, rssi and blacklist", cmd_hop_show, 1, 0),
+							   SHELL_CMD_ARG(to, NULL, "<channel>, move the fleet", cmd_hop_to, 2, 0),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(hop, &hop_cmds, "ESB channel hopping", cmd_hop_show);
+#endif
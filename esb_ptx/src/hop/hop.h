@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef HOP_H_
+#define HOP_H_
+
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* Fleet-wide channel hopping on the shared channel. The PTX keeps loss and ack RSSI per
+ * channel of esb_common_hop_channels, blacklists a channel whose loss goes over
+ * CONFIG_ESB_PTX_HOP_BLACKLIST_PERMILLE for CONFIG_ESB_PTX_HOP_BLACKLIST_MS and picks the
+ * channel the fleet should be on. Nodes still on another channel get an ESB_PROTO_HOP
+ * instead of their next poll, once it's acked the node table follows.
+ * The PRX goes back to its old channel if it isn't polled on the new one soon (hop ack
+ * lost) and scans the hop table when it's lost track altogether.
+ */
+
+struct hop_channel_stats
+{
+	uint8_t channel;
+	bool blacklisted;
+	uint32_t tx_success;
+	uint32_t tx_failed;
+	uint32_t loss_permille; // recent, averaged
+	int8_t rssi_avg;		// dBm, acks with payload
+};
+
+// esb irq context, every poll result
+void hop_on_tx_result(int node, uint8_t channel, bool success, const struct esb_payload *ack);
+
+// poll loop, before picking the next node: moves nodes whose hop got acked, updates the
+// blacklist and decides if the fleet moves
+void hop_update(void);
+
+// poll loop: true (and payload built) if the node has to be told to move first. only nodes on a hop
+// channel follow the fleet, one added on another channel keeps it.
+bool hop_build_request(int node, struct esb_payload *payload);
+
+uint8_t hop_channel(void);
+// move the fleet to a channel by hand, -EINVAL if it's not in the hop table
+int hop_set_channel(uint8_t channel);
+
+// -EINVAL past the end of the hop table
+int hop_get_stats(int index, struct hop_channel_stats *stats);
+
+#endif /* HOP_H_ */
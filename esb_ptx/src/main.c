@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
  * author: johnny nguyen
  */
+#include <string.h>
 #include <zephyr/drivers/clock_control.h>
 #include <zephyr/drivers/clock_control/nrf_clock_control.h>
 #include <zephyr/drivers/gpio.h>
@@ -14,6 +15,8 @@
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
 #include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/timing/timing.h>
 #include <zephyr/types.h>
 #include <nrfx_gpiote.h>
 
@@ -21,12 +24,30 @@
 #include <hal/nrf_radio.h>
 #include <hal/nrf_uarte.h>
 
+#include "bcast/bcast.h"
+#include "bulk/bulk.h"
+#include "downlink/downlink.h"
+#include "edf/edf.h"
+#include "esb_common.h"
+#include "esb_frame.h"
+#include "esb_proto.h"
+#include "esb_rx_ring.h"
+#include "esb_trace.h"
+#include "hop/hop.h"
+#include "link_stats.h"
+#include "nodes/nodes.h"
+#include "pacer/pacer.h"
+#include "retx/retx.h"
+#include "tdma/tdma.h"
+#include "txn/txn.h"
+
 LOG_MODULE_REGISTER(esb_ptx);
 
 // radio debug pin
 #define TEST_PIN 31
 static void radio_ppi_trace_setup(void)
 {
+#if defined(CONFIG_PPI_TRACE) // not available on the simulated radio
 	uint32_t start_evt;
 	uint32_t stop_evt;
 	void *handle;
@@ -41,6 +62,7 @@ static void radio_ppi_trace_setup(void)
 	__ASSERT(handle != NULL, "Failed to configure PPI trace pair.\n");
 
 	ppi_trace_enable(handle);
+#endif
 }
 
 static const struct gpio_dt_spec leds[] = {
@@ -58,56 +80,176 @@ BUILD_ASSERT(DT_SAME_NODE(DT_GPIO_CTLR(DT_ALIAS(led0), gpios),
 							  DT_GPIO_CTLR(DT_ALIAS(led3), gpios)),
 			 "All LEDs must be on the same port");
 
-static bool ready = true;
-static struct esb_payload rx_payload;
-static struct esb_payload tx_payload = ESB_CREATE_PAYLOAD(0,
-														  0x01, 0x00, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08);
-
-/* These are arbitrary default addresses. In end user products
- * different addresses should be used for each set of devices.
- */
-#define NUM_PRX_PERIPH 2
-uint8_t g_base_addr_0[NUM_PRX_PERIPH][4] = {{0xE7, 0xE7, 0xE7, 0xE7}, {0xEE, 0xEE, 0xEE, 0xEE}};
-uint32_t g_channels[NUM_PRX_PERIPH] = {2, 4}; // channel selection per periph
-volatile int g_periph_choice = 0;
-volatile bool swap_device = false;
-
-#define _RADIO_SHORTS_COMMON                                       \
-	(RADIO_SHORTS_READY_START_Msk | RADIO_SHORTS_END_DISABLE_Msk | \
-	 RADIO_SHORTS_ADDRESS_RSSISTART_Msk |                          \
-	 RADIO_SHORTS_DISABLED_RSSISTOP_Msk)
+static struct esb_rx_ring rx_ring; // filled by event_handler, drained by rx_thread
+static K_SEM_DEFINE(rx_sem, 0, 1);
+static struct esb_payload tx_payload; // rebuilt for every poll from the node's downlink queue
+static atomic_t records_in; // application records unpacked from ack payloads
+
+// addresses/channels come from the node table (nodes/nodes.c), g_periph_choice is a node id.
+volatile int g_periph_choice = -1;
+static struct node_cfg active_radio; // radio settings of the running esb session
+static struct retx_policy active_retx;
+
+// the tx loop in main sleeps on these instead of spinning
+static K_SEM_DEFINE(radio_idle_sem, 1, 1); // given by event_handler once the current poll is done
+static K_SEM_DEFINE(start_sem, 0, 1);	   // given by button 1
+
+// poll rate + loop timing bookkeeping, printed once a second from main. cycles are timing api (DWT) cycles.
+static volatile uint32_t polls_ok;
+static volatile uint32_t polls_failed;
+static uint32_t supervision_timeouts;
+static volatile timing_t last_evt_time; // when event_handler released the loop
+
+// node rotations that changed channel/address/bitrate, reset with the once a second report
+static uint32_t radio_switches;
+static uint32_t radio_reinits; // a setter refused, fell back to esb_disable() + esb_init()
+static uint64_t switch_sum_cyc;
+static uint64_t switch_max_cyc;
+
+// what is on air right now, for the per-node link stats
+#define POLLED_BCAST -2 // a broadcast, not a poll of any node
+static volatile int polled_node = -1;
+static volatile timing_t poll_start_time; // esb_write_payload() of the packet on air
+
+struct poll_timing
+{
+	uint64_t idle_cyc;	  // main blocked on radio_idle_sem
+	uint64_t p2p_sum_cyc; // poll to poll, esb_write_payload() to the next one
+	uint64_t p2p_max_cyc;
+	uint64_t evt_sum_cyc; // esb event to the next esb_write_payload(), the part sw scheduling adds
+	uint64_t evt_max_cyc;
+	uint32_t polls;
+};
 
 void event_handler(struct esb_evt const *event)
 {
-	ready = true;
+	struct esb_payload *ack;
+	timing_t now = timing_counter_get();
+	timing_t start = poll_start_time;
+
 	/*note: Not using devicetree to make sure this is as fast as possible*/
 	nrf_gpio_pin_toggle(TEST_PIN);
 
+#if defined(CONFIG_ESB_PTX_BCAST)
+	if (polled_node == POLLED_BCAST && event->evt_id != ESB_EVENT_RX_RECEIVED)
+	{
+		// noack, the event only says it's on air. no node to account it to.
+		last_evt_time = timing_counter_get();
+		k_sem_give(&radio_idle_sem);
+		return;
+	}
+#endif
+
 	switch (event->evt_id)
 	{
 	case ESB_EVENT_TX_SUCCESS:
-		LOG_DBG("TX SUCCESS EVENT");
-		swap_device = true; // TODO:DEBUG:rotate device when we hear back
+		polls_ok++;
+		// the ack payload is already in the rx fifo, take it now so a transaction can follow up back to back
+		ack = esb_rx_ring_fill(&rx_ring);
+		ESB_TRACE_POINT(ESB_TRACE_TX_SUCCESS, polled_node, ack ? ack->length : 0, ack ? -ack->rssi : 0,
+						event->tx_attempts);
+		link_stats_tx(polled_node, true);
+		retx_on_tx_result(polled_node, true, event->tx_attempts);
+#if defined(CONFIG_ESB_PTX_FIXED_RATE)
+		pacer_on_tx_result(event->tx_attempts);
+#endif
+		nodes_on_poll_result(polled_node, true);
+		downlink_on_tx_result(polled_node, true);
+		bulk_on_tx_result(polled_node, true, ack);
+#if defined(CONFIG_ESB_PTX_HOP)
+		hop_on_tx_result(polled_node, active_radio.channel, true, ack);
+#endif
+		link_stats_latency(polled_node, timing_cycles_get(&start, &now));
+		if (ack)
+		{
+			link_stats_rx(polled_node, ack->rssi, ack->length);
+			k_sem_give(&rx_sem);
+		}
+		else
+		{
+			link_stats_empty_ack(polled_node);
+		}
+		if (txn_on_tx_success(ack))
+		{
+			poll_start_time = now;
+			break; // pickup on air, radio still busy
+		}
+		last_evt_time = timing_counter_get();
+		k_sem_give(&radio_idle_sem);
 		break;
 	case ESB_EVENT_TX_FAILED:
-		LOG_DBG("TX FAILED EVENT");
+		ESB_TRACE_POINT(ESB_TRACE_TX_FAILED, polled_node, 0, 0, event->tx_attempts);
+		polls_failed++;
+		link_stats_tx(polled_node, false);
+		retx_on_tx_result(polled_node, false, event->tx_attempts);
+#if defined(CONFIG_ESB_PTX_FIXED_RATE)
+		pacer_on_tx_result(event->tx_attempts);
+#endif
+		nodes_on_poll_result(polled_node, false);
+		downlink_on_tx_result(polled_node, false);
+		bulk_on_tx_result(polled_node, false, NULL);
+#if defined(CONFIG_ESB_PTX_HOP)
+		hop_on_tx_result(polled_node, active_radio.channel, false, NULL);
+#endif
+		if (txn_on_tx_failed())
+		{
+			poll_start_time = now;
+			break;
+		}
+		last_evt_time = timing_counter_get();
+		k_sem_give(&radio_idle_sem);
 		break;
 	case ESB_EVENT_RX_RECEIVED:
-		while (esb_read_rx_payload(&rx_payload) == 0)
+		// no logging in here, the rx thread does that
+		esb_rx_ring_fill(&rx_ring);
+		k_sem_give(&rx_sem);
+		break;
+	}
+}
+
+// rx consumer thread, handles what the esb callback put in the ring
+#define RX_THREAD_STACK_SIZE 1024
+#define RX_THREAD_PRIORITY 5
+
+static void rx_thread(void)
+{
+	atomic_val_t reported_overflows = 0;
+	struct esb_payload *rx_payload;
+
+	while (1)
+	{
+		k_sem_take(&rx_sem, K_FOREVER);
+
+		while ((rx_payload = esb_rx_ring_peek(&rx_ring)) != NULL)
+		{
+			const struct esb_proto_hdr *hdr = (const struct esb_proto_hdr *)rx_payload->data;
+			const uint8_t *record;
+			uint8_t offset = 0;
+			uint8_t len;
+
+			// transaction responses are handled in the esb callback already
+			if (rx_payload->length >= ESB_PROTO_HDR_LEN && hdr->type == ESB_PROTO_DATA)
+			{
+				while ((record = esb_frame_next(rx_payload, &offset, &len)) != NULL)
+				{
+					ESB_TRACE_POINT(ESB_TRACE_RECORD, rx_payload->pipe, len, 0, len > 1 ? sys_get_le16(record) : record[0]);
+					atomic_inc(&records_in);
+				}
+			}
+			esb_rx_ring_release(&rx_ring);
+		}
+
+		atomic_val_t overflows = atomic_get(&rx_ring.overflows);
+		if (overflows != reported_overflows)
 		{
-			LOG_DBG("Packet received, len %d : "
-					"0x%02x, 0x%02x, 0x%02x, 0x%02x, "
-					"0x%02x, 0x%02x, 0x%02x, 0x%02x",
-					rx_payload.length, rx_payload.data[0],
-					rx_payload.data[1], rx_payload.data[2],
-					rx_payload.data[3], rx_payload.data[4],
-					rx_payload.data[5], rx_payload.data[6],
-					rx_payload.data[7]);
+			LOG_WRN("RX ring full, %ld packets dropped so far", overflows);
+			reported_overflows = overflows;
 		}
-		break;
 	}
 }
 
+K_THREAD_DEFINE(rx_thread_id, RX_THREAD_STACK_SIZE, rx_thread, NULL, NULL, NULL, RX_THREAD_PRIORITY, 0, 0);
+
 int clocks_start(void)
 {
 	int err;
@@ -145,23 +287,23 @@ int clocks_start(void)
 	return 0;
 }
 
-int esb_initialize(int peripheral_choice)
+int esb_initialize(const struct node_cfg *node)
 {
 	int err;
 
-	uint8_t base_addr_1[4] = {0xC2, 0xC2, 0xC2, 0xC2};
-	uint8_t addr_prefix[8] = {0xE7, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8};
-
 	struct esb_config config = ESB_DEFAULT_CONFIG;
 
 	config.protocol = ESB_PROTOCOL_ESB_DPL;
-	config.retransmit_delay = 600;
-	config.bitrate = ESB_BITRATE_2MBPS;
+	config.retransmit_delay = 600; // per node from here on, see app_esb_apply_retx()
+	config.bitrate = node->bitrate;
 	config.event_handler = event_handler;
 	config.mode = ESB_MODE_PTX;
 	config.selective_auto_ack = true;
 	config.retransmit_count = 0; // dont retransmit.
 	config.use_fast_ramp_up = true;
+#if defined(CONFIG_ESB_PTX_FIXED_RATE)
+	config.tx_mode = ESB_TXMODE_MANUAL_START; // the pacer tick starts each poll
+#endif
 
 	err = esb_init(&config);
 
@@ -170,30 +312,33 @@ int esb_initialize(int peripheral_choice)
 		return err;
 	}
 
-	err = esb_set_base_address_0(g_base_addr_0[peripheral_choice]);
+	err = esb_set_base_address_0(node->base_addr_0);
 	if (err)
 	{
 		return err;
 	}
 
-	err = esb_set_base_address_1(base_addr_1);
+	err = esb_set_base_address_1(esb_common_base_addr_1);
 	if (err)
 	{
 		return err;
 	}
 
-	err = esb_set_prefixes(addr_prefix, ARRAY_SIZE(addr_prefix));
+	err = esb_set_prefixes(esb_common_addr_prefix, ARRAY_SIZE(esb_common_addr_prefix));
 	if (err)
 	{
 		return err;
 	}
 
-	err = esb_set_rf_channel(g_channels[peripheral_choice]);
+	err = esb_set_rf_channel(node->channel);
 	if (err)
 	{
 		return err;
 	}
 
+	active_radio = *node;
+	active_retx.count = config.retransmit_count;
+	active_retx.delay_us = config.retransmit_delay;
 	return 0;
 }
 
@@ -219,24 +364,6 @@ static int leds_init(void)
 	return 0;
 }
 
-static void leds_update(uint8_t value)
-{
-	bool led0_status = !(value % 8 > 0 && value % 8 <= 4);
-	bool led1_status = !(value % 8 > 1 && value % 8 <= 5);
-	bool led2_status = !(value % 8 > 2 && value % 8 <= 6);
-	bool led3_status = !(value % 8 > 3);
-
-	gpio_port_pins_t mask = BIT(leds[0].pin) | BIT(leds[1].pin) |
-							BIT(leds[2].pin) | BIT(leds[3].pin);
-
-	gpio_port_value_t val = led0_status << leds[0].pin |
-							led1_status << leds[1].pin |
-							led2_status << leds[2].pin |
-							led3_status << leds[3].pin;
-
-	(void)gpio_port_set_masked_raw(leds[0].port, mask, val);
-}
-
 // 52840dk
 #define dk_button1_msk 1 << 11 // button1 is gpio pin 11 in the .dts
 #define dk_button2_msk 1 << 12 // button2 is gpio pin 12 in the .dts
@@ -251,7 +378,6 @@ static const struct gpio_dt_spec buttons[] = {
 };
 
 static struct gpio_callback button_callback;
-volatile bool start_test = false;
 
 void button_pressed(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
@@ -262,7 +388,7 @@ void button_pressed(const struct device *dev, struct gpio_callback *cb, uint32_t
 	{
 	case dk_button1_msk:
 		LOG_INF("BUTTON1");
-		start_test = true;
+		k_sem_give(&start_sem);
 		break;
 
 	case dk_button2_msk:
@@ -336,14 +462,239 @@ static int buttons_init(void)
 	return err;
 }
 
-static void app_esb_rotate_device(int peripheral_choice)
+// esb has to be idle, which it is between polls
+static int app_esb_apply_retx(int node_id, const struct node_cfg *node)
+{
+	struct retx_policy policy;
+	int err;
+
+	retx_get(node_id, node->bitrate, &policy);
+	if (policy.count != active_retx.count)
+	{
+		err = esb_set_retransmit_count(policy.count);
+		if (err)
+		{
+			return err;
+		}
+		active_retx.count = policy.count;
+	}
+
+	if (policy.delay_us != active_retx.delay_us)
+	{
+		err = esb_set_retransmit_delay(policy.delay_us);
+		if (err)
+		{
+			return err;
+		}
+		active_retx.delay_us = policy.delay_us;
+	}
+
+	return 0;
+}
+
+/* Moves the running esb session to another node's channel/base address 0/bitrate with the
+ * esb setters, only touching what differs (base address 0 only for a pipe 0 node). They all need esb idle, which it is between
+ * polls: the loop only gets here once the event for the last poll came in (that's all the
+ * old swap flag in the callback was about). No flush of the fifos, no radio re-init.
+ */
+static int app_esb_switch_radio(const struct node_cfg *node)
+{
+	int err;
+
+	if (node->channel != active_radio.channel)
+	{
+		err = esb_set_rf_channel(node->channel);
+		if (err)
+		{
+			return err;
+		}
+		active_radio.channel = node->channel;
+	}
+
+	if (node->pipe == 0 && memcmp(node->base_addr_0, active_radio.base_addr_0, sizeof(node->base_addr_0)) != 0)
+	{
+		err = esb_set_base_address_0(node->base_addr_0);
+		if (err)
+		{
+			return err;
+		}
+		memcpy(active_radio.base_addr_0, node->base_addr_0, sizeof(active_radio.base_addr_0));
+	}
+
+	if (node->bitrate != active_radio.bitrate)
+	{
+		err = esb_set_bitrate(node->bitrate);
+		if (err)
+		{
+			return err;
+		}
+		active_radio.bitrate = node->bitrate;
+	}
+
+	return 0;
+}
+
+static int app_esb_rotate_device(int node_id)
+{
+	struct node_cfg node;
+	int err;
+
+	err = nodes_get_cfg(node_id, &node);
+	if (err)
+	{
+		return err; // removed from the shell in the meantime
+	}
+
+	tx_payload.pipe = node.pipe;
+	// same esb session: addressing the pipe is enough
+	if (!nodes_same_radio(&node, &active_radio))
+	{
+		timing_t switch_start = timing_counter_get();
+
+		err = app_esb_switch_radio(&node);
+		if (err)
+		{
+			// the old esb_disable() + esb_init() rotation, always works from idle
+			radio_reinits++;
+#if defined(CONFIG_ESB_PTX_FIXED_RATE)
+			pacer_hold(true);
+#endif
+			esb_disable();
+			err = esb_initialize(&node);
+			if (err)
+			{
+				// back to the last radio that worked (active_radio only changes on success), the caller skips this poll
+				LOG_ERR("ESB init for node %d failed, err %d", node_id, err);
+				if (esb_initialize(&active_radio))
+				{
+					LOG_ERR("ESB reinit failed too");
+				}
+			}
+#if defined(CONFIG_ESB_PTX_FIXED_RATE)
+			pacer_hold(false);
+#endif
+			if (err)
+			{
+				return err;
+			}
+		}
+
+		timing_t switch_end = timing_counter_get();
+		uint64_t cyc = timing_cycles_get(&switch_start, &switch_end);
+
+		radio_switches++;
+		switch_sum_cyc += cyc;
+		switch_max_cyc = MAX(switch_max_cyc, cyc);
+	}
+
+	return app_esb_apply_retx(node_id, &node);
+}
+
+// the esb event for the last poll never came, don't let that stall the loop
+static void app_esb_recover(void)
 {
-	// TODO: Why does this rotation require the swap flag in the ESB callback?
-	esb_disable();
-	esb_initialize(peripheral_choice); // gotta do this if using esb_disable
-	esb_start_tx();
+	int err;
+
+	supervision_timeouts++;
+	ESB_TRACE_POINT(ESB_TRACE_RECOVER, polled_node, 0, 0, 0);
+	LOG_WRN("No ESB event for node %d in %d ms, reinitializing (%u so far)", polled_node,
+			CONFIG_ESB_PTX_TX_SUPERVISION_MS, supervision_timeouts);
+
+#if defined(CONFIG_ESB_PTX_FIXED_RATE)
+	pacer_hold(true);
+#endif
+	esb_disable(); // no more events for whatever was on air
+	txn_abort(-EIO);
+	link_stats_tx(polled_node, false);
+	nodes_on_poll_result(polled_node, false);
+	downlink_on_tx_result(polled_node, false);
+	bulk_on_tx_result(polled_node, false, NULL);
+
+	err = esb_initialize(&active_radio);
+	if (err)
+	{
+		LOG_ERR("ESB reinit failed, err %d", err);
+	}
+#if defined(CONFIG_ESB_PTX_FIXED_RATE)
+	pacer_hold(false);
+#endif
+	k_sem_reset(&radio_idle_sem); // in case the event squeezed in after all
+}
+
+static void poll_timing_report(struct poll_timing *t, uint64_t window_cyc)
+{
+	uint32_t polls = MAX(t->polls, 1);
+
+	LOG_INF("polls/sec: %u ok, %u failed, %ld records in, idle %u%%", polls_ok, polls_failed,
+			atomic_clear(&records_in), (uint32_t)(t->idle_cyc * 100 / MAX(window_cyc, 1)));
+	LOG_INF("poll to poll avg %u us max %u us, event to next poll avg %u us max %u us",
+			(uint32_t)(timing_cycles_to_ns(t->p2p_sum_cyc / polls) / NSEC_PER_USEC),
+			(uint32_t)(timing_cycles_to_ns(t->p2p_max_cyc) / NSEC_PER_USEC),
+			(uint32_t)(timing_cycles_to_ns(t->evt_sum_cyc / polls) / NSEC_PER_USEC),
+			(uint32_t)(timing_cycles_to_ns(t->evt_max_cyc) / NSEC_PER_USEC));
+
+#if defined(CONFIG_ESB_PTX_TDMA)
+	LOG_INF("tdma: %u slots missed so far", tdma_overruns());
+#endif
+#if defined(CONFIG_ESB_PTX_EDF)
+	LOG_INF("edf: %u deadlines missed so far", edf_misses());
+#endif
+	if (radio_switches)
+	{
+		LOG_INF("radio switches: %u, avg %u us max %u us, %u needed a reinit", radio_switches,
+				(uint32_t)(timing_cycles_to_ns(switch_sum_cyc / radio_switches) / NSEC_PER_USEC),
+				(uint32_t)(timing_cycles_to_ns(switch_max_cyc) / NSEC_PER_USEC), radio_reinits);
+	}
+#if defined(CONFIG_ESB_PTX_FIXED_RATE)
+	struct pacer_stats pacer;
+
+	pacer_stats_get(&pacer);
+	LOG_INF("pacer: %u ticks, %u not ready, %u busy, tick to air min %u avg %u max %u ns (jitter %u ns)",
+			pacer.ticks, pacer.not_ready, pacer.busy, pacer.min_ns, pacer.avg_ns, pacer.max_ns,
+			pacer.samples ? pacer.max_ns - pacer.min_ns : 0);
+#endif
+
+	polls_ok = 0;
+	polls_failed = 0;
+	radio_switches = 0;
+	radio_reinits = 0;
+	switch_sum_cyc = 0;
+	switch_max_cyc = 0;
+	*t = (struct poll_timing){0};
 }
 
+#if CONFIG_ESB_PTX_BENCH_DURATION_MS > 0
+static void bench_report(uint32_t elapsed_ms)
+{
+	struct node_cfg cfg;
+	struct link_stats stats;
+	uint32_t polls = 0;
+	uint32_t failed = 0;
+	uint32_t bytes = 0;
+
+	for (int i = 0; i < NODES_MAX; i++)
+	{
+		if (nodes_get_cfg(i, &cfg) || link_stats_get(i, &stats))
+		{
+			continue;
+		}
+		polls += stats.tx_success + stats.tx_failed;
+		failed += stats.tx_failed;
+		bytes += stats.rx_bytes;
+		LOG_INF("bench: node %d polls %u fail %u p50 %u us p99 %u us max %u us", i,
+				stats.tx_success + stats.tx_failed, stats.tx_failed, link_stats_percentile(&stats, 50),
+				link_stats_percentile(&stats, 99), stats.latency_max_us);
+	}
+
+	uint32_t fail_bp = (uint64_t)failed * 10000 / MAX(polls, 1); // basis points
+
+	elapsed_ms = MAX(elapsed_ms, 1);
+	LOG_INF("bench: nodes %d polls/sec %u goodput %u B/s fail %u.%02u%%", nodes_count(),
+			(uint32_t)((uint64_t)polls * MSEC_PER_SEC / elapsed_ms), (uint32_t)((uint64_t)bytes * MSEC_PER_SEC / elapsed_ms),
+			fail_bp / 100, fail_bp % 100);
+}
+#endif
+
 int main(void)
 {
 	int err;
@@ -356,6 +707,9 @@ int main(void)
 
 	radio_ppi_trace_setup();
 
+	timing_init();
+	timing_start();
+
 	err = clocks_start();
 	if (err)
 	{
@@ -374,45 +728,233 @@ int main(void)
 		return 0;
 	}
 
-	while (!start_test)
+	// press button 1 to leave
+	if (!IS_ENABLED(CONFIG_ESB_PTX_AUTOSTART))
+	{
+		k_sem_take(&start_sem, K_FOREVER);
+	}
+
+	struct node_cfg first_node;
+
+	g_periph_choice = nodes_next(-1);
+	if (g_periph_choice < 0 || nodes_get_cfg(g_periph_choice, &first_node))
 	{
-		// press button 1 to leave
+		LOG_ERR("No nodes to poll, add some with the node shell command");
+		return 0;
 	}
 
-	err = esb_initialize(g_periph_choice);
+	err = esb_initialize(&first_node);
 	if (err)
 	{
 		LOG_ERR("ESB initialization failed, err %d", err);
 		return 0;
 	}
 
+#if defined(CONFIG_ESB_PTX_FIXED_RATE)
+	err = pacer_start(CONFIG_ESB_PTX_FIXED_RATE_PERIOD_US);
+	if (err)
+	{
+		LOG_ERR("Pacer start failed, err %d", err);
+		return 0;
+	}
+#endif
+
 	LOG_INF("Initialization complete");
-	LOG_INF("Sending test packet");
+	LOG_INF("Polling %d nodes", nodes_count());
+
+	struct poll_timing timing = {0};
+#if !defined(CONFIG_ESB_PTX_TDMA) && !defined(CONFIG_ESB_PTX_EDF)
+	uint32_t bulk_polls = 0;
+#endif
+	int64_t rate_report_time = k_uptime_get() + MSEC_PER_SEC;
+	timing_t report_start = timing_counter_get();
+	timing_t last_poll_time = report_start;
+
+	last_evt_time = report_start;
+
+#if CONFIG_ESB_PTX_BENCH_DURATION_MS > 0
+	int64_t bench_start = k_uptime_get();
+
+	link_stats_reset();
+#endif
 
 	tx_payload.noack = false;
 	while (1)
 	{
-		if (ready)
+		// sleep until event_handler says the radio is done with the last poll
+		timing_t wait_start = timing_counter_get();
+		if (k_sem_take(&radio_idle_sem, K_MSEC(CONFIG_ESB_PTX_TX_SUPERVISION_MS)))
+		{
+			app_esb_recover();
+		}
+		timing_t wait_end = timing_counter_get();
+		timing.idle_cyc += timing_cycles_get(&wait_start, &wait_end);
+
+#if CONFIG_ESB_PTX_BENCH_DURATION_MS > 0
+		if (k_uptime_get() - bench_start >= CONFIG_ESB_PTX_BENCH_DURATION_MS)
+		{
+#if defined(CONFIG_ESB_PTX_FIXED_RATE)
+			pacer_stop();
+#endif
+			esb_disable();
+			bench_report(k_uptime_get() - bench_start);
+			return 0;
+		}
+#endif
+
+#if defined(CONFIG_ESB_PTX_HOP)
+		hop_update();
+#endif
+
+		// a waiting transaction jumps the round-robin, the poll order carries on after it
+		uint8_t txn_id;
+		int txn_node = txn_pending_node(&txn_id);
+		if (txn_node >= 0)
 		{
-			if (true)
+			err = app_esb_rotate_device(txn_node);
+			esb_flush_tx();
+			polled_node = txn_node;
+			poll_start_time = timing_counter_get();
+			if (err)
+			{
+				txn_cancel(txn_id, err);
+				k_sem_give(&radio_idle_sem);
+			}
+			else if (txn_send_request(txn_id, tx_payload.pipe))
+			{
+				k_sem_give(&radio_idle_sem); // no event will come for this one
+			}
+			else
 			{
-				swap_device = false;
-				g_periph_choice = (g_periph_choice + 1) % NUM_PRX_PERIPH;
-				app_esb_rotate_device(g_periph_choice);
+				ESB_TRACE_POINT(ESB_TRACE_TX_WRITE, txn_node, 0, 0, ESB_PROTO_TXN_REQ);
 			}
-			ready = false;
+			continue;
+		}
+
+#if defined(CONFIG_ESB_PTX_BCAST)
+		// a broadcast copy takes the next poll's place, on whatever channel the session is on
+		const struct esb_payload *bcast = bcast_next();
+		if (bcast)
+		{
 			esb_flush_tx();
-			// leds_update(tx_payload.data[1]);
+			polled_node = POLLED_BCAST;
+			ESB_TRACE_POINT(ESB_TRACE_BCAST, bcast->pipe, bcast->length, 0, bcast->data[1]);
+			if (esb_write_payload(bcast))
+			{
+				k_sem_give(&radio_idle_sem);
+			}
+			continue;
+		}
+#endif
 
-			err = esb_write_payload(&tx_payload);
-			if (err)
+#if defined(CONFIG_ESB_PTX_TDMA)
+		// fixed schedule, absent nodes and bulk transfers get their own slot and nothing more
+		int64_t slot_ticks;
+		int next = tdma_next(&slot_ticks);
+		if (next < 0)
+		{
+			k_sem_give(&radio_idle_sem);
+			k_msleep(100);
+			continue;
+		}
+		k_sleep(K_TIMEOUT_ABS_TICKS(slot_ticks));
+		g_periph_choice = next;
+#elif defined(CONFIG_ESB_PTX_EDF)
+		// released periodic polls by earliest deadline, the slack goes to a bulk transfer, then to best effort nodes
+		int64_t wake_ticks;
+		int next = edf_next(&wake_ticks);
+		if (next < 0)
+		{
+			next = bulk_active_node();
+		}
+		if (next < 0)
+		{
+			next = edf_next_best_effort(g_periph_choice);
+			if (next < 0)
+			{
+				k_sem_give(&radio_idle_sem); // nothing was sent, radio is still free
+				k_sleep(K_TIMEOUT_ABS_TICKS(wake_ticks));
+				continue;
+			}
+			g_periph_choice = next;
+		}
+#else
+		// a bulk transfer gets its node polled back to back, with a round-robin poll every so often
+		int next = bulk_active_node();
+		if (next >= 0 && bulk_polls < CONFIG_ESB_PTX_BULK_BURST)
+		{
+			bulk_polls++;
+		}
+		else
+		{
+			bulk_polls = 0;
+			next = nodes_next(g_periph_choice);
+			if (next < 0)
+			{
+				// empty table, or every node is absent and waiting out its backoff
+				k_sem_give(&radio_idle_sem); // nothing was sent, radio is still free
+				k_msleep(next == -EAGAIN ? CONFIG_ESB_PTX_BACKOFF_MIN_MS : 100);
+				continue;
+			}
+			g_periph_choice = next;
+		}
+#endif
+
+		err = app_esb_rotate_device(next);
+		if (err)
+		{
+			// removed from the shell in the meantime, or the radio can't be set up for it. nothing was sent.
+			if (err != -ENOENT)
 			{
-				LOG_ERR("Payload write failed, err %d", err);
+				nodes_on_poll_result(next, false); // a node that keeps failing backs off like an absent one
 			}
-			tx_payload.data[1]++;
+			k_sem_give(&radio_idle_sem);
+			continue;
+		}
+		esb_flush_tx();
+
+		bool built = bulk_build_request(next, &tx_payload);
+#if defined(CONFIG_ESB_PTX_TDMA)
+		built = built || tdma_build_sync(next, &tx_payload, k_ticks_to_us_floor32(k_uptime_ticks() - slot_ticks));
+#endif
+#if defined(CONFIG_ESB_PTX_HOP)
+		// a node that hasn't followed the fleet yet gets a hop instead, its records wait a poll
+		built = built || hop_build_request(next, &tx_payload);
+#endif
+		if (!built)
+		{
+			// header + as many queued records for this node as fit
+			downlink_pack(next, &tx_payload);
+		}
+
+		polled_node = next;
+		poll_start_time = timing_counter_get();
+		err = esb_write_payload(&tx_payload);
+		ESB_TRACE_POINT(ESB_TRACE_TX_WRITE, next, tx_payload.length, 0, tx_payload.data[0]);
+		if (err)
+		{
+			LOG_ERR("Payload write failed, err %d", err);
+			downlink_on_tx_result(next, false);
+			k_sem_give(&radio_idle_sem); // no event will come for this one
 		}
 
-		k_yield();
-		// k_sleep(K_MSEC(100)); // TODO: probably want to remove this for performance gauging.
+		timing_t poll_time = timing_counter_get();
+		timing_t evt_time = last_evt_time;
+		uint64_t p2p = timing_cycles_get(&last_poll_time, &poll_time);
+		uint64_t evt = timing_cycles_get(&evt_time, &poll_time);
+
+		timing.p2p_sum_cyc += p2p;
+		timing.p2p_max_cyc = MAX(timing.p2p_max_cyc, p2p);
+		timing.evt_sum_cyc += evt;
+		timing.evt_max_cyc = MAX(timing.evt_max_cyc, evt);
+		timing.polls++;
+		last_poll_time = poll_time;
+
+		if (k_uptime_get() >= rate_report_time)
+		{
+			poll_timing_report(&timing, timing_cycles_get(&report_start, &poll_time));
+			report_start = poll_time;
+			rate_report_time += MSEC_PER_SEC;
+		}
 	}
 }
@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+#include "esb_common.h"
+#include "bulk/bulk.h"
+#include "downlink/downlink.h"
+#include "edf/edf.h"
+#include "nodes.h"
+#include "retx/retx.h"
+
+LOG_MODULE_REGISTER(nodes);
+
+struct node
+{
+	bool in_use;
+	struct node_cfg cfg;
+	struct node_liveness liveness;
+	int64_t next_poll_ms; // absent nodes are skipped until then
+};
+
+static struct node node_table[NODES_MAX];
+static K_MUTEX_DEFINE(node_lock);	  // shell thread edits the table while the poller walks it
+static struct k_spinlock liveness_lock; // liveness is updated from the esb callback
+
+static bool node_cfg_equal(const struct node_cfg *a, const struct node_cfg *b)
+{
+	return a->pipe == b->pipe && nodes_same_radio(a, b);
+}
+
+bool nodes_same_radio(const struct node_cfg *node, const struct node_cfg *radio)
+{
+	// base addr 0 is only on air for pipe 0
+	return node->channel == radio->channel && node->bitrate == radio->bitrate &&
+		   (node->pipe != 0 || memcmp(node->base_addr_0, radio->base_addr_0, sizeof(node->base_addr_0)) == 0);
+}
+
+int nodes_add(const struct node_cfg *cfg)
+{
+	int id = -ENOMEM;
+
+	if (cfg->pipe >= ESB_COMMON_NUM_PIPES || cfg->channel > ESB_COMMON_MAX_RF_CHANNEL)
+	{
+		return -EINVAL;
+	}
+
+#if defined(CONFIG_ESB_PTX_BCAST)
+	if (cfg->pipe == ESB_COMMON_BCAST_PIPE)
+	{
+		return -EINVAL; // the prxs all listen there
+	}
+#endif
+
+	k_mutex_lock(&node_lock, K_FOREVER);
+	for (int i = NODES_MAX - 1; i >= 0; i--)
+	{
+		if (node_table[i].in_use && node_cfg_equal(&node_table[i].cfg, cfg))
+		{
+			id = -EEXIST;
+			break;
+		}
+		if (!node_table[i].in_use)
+		{
+			id = i; // keep going, want the lowest free slot and no duplicates
+		}
+	}
+
+	if (id >= 0)
+	{
+		k_spinlock_key_t key = k_spin_lock(&liveness_lock);
+
+		node_table[id].liveness = (struct node_liveness){0};
+		node_table[id].next_poll_ms = 0;
+		k_spin_unlock(&liveness_lock, key);
+
+		node_table[id].cfg = *cfg;
+		node_table[id].in_use = true;
+		retx_reset(id); // new node, the old one's link history and records don't apply
+		downlink_reset(id);
+#if defined(CONFIG_ESB_PTX_EDF)
+		edf_reset(id);
+#endif
+	}
+	k_mutex_unlock(&node_lock);
+
+	return id;
+}
+
+int nodes_remove(int id)
+{
+	if (id < 0 || id >= NODES_MAX)
+	{
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&node_lock, K_FOREVER);
+	int err = node_table[id].in_use ? 0 : -ENOENT;
+	node_table[id].in_use = false;
+	if (!err)
+	{
+		// give the pool messages back and the poll budget to the other nodes now, not on reuse
+		downlink_reset(id);
+#if defined(CONFIG_ESB_PTX_EDF)
+		edf_reset(id);
+#endif
+	}
+	k_mutex_unlock(&node_lock);
+
+	bulk_abort(id, -ENODEV); // or the poll loop keeps picking a node it can't switch to
+	return err;
+}
+
+int nodes_get_cfg(int id, struct node_cfg *cfg)
+{
+	int err = -ENOENT;
+
+	if (id < 0 || id >= NODES_MAX)
+	{
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&node_lock, K_FOREVER);
+	if (node_table[id].in_use)
+	{
+		*cfg = node_table[id].cfg;
+		err = 0;
+	}
+	k_mutex_unlock(&node_lock);
+
+	return err;
+}
+
+int nodes_set_channel(int id, uint8_t channel)
+{
+	int err = -ENOENT;
+
+	if (id < 0 || id >= NODES_MAX || channel > ESB_COMMON_MAX_RF_CHANNEL)
+	{
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&node_lock, K_FOREVER);
+	if (node_table[id].in_use)
+	{
+		node_table[id].cfg.channel = channel;
+		err = 0;
+	}
+	k_mutex_unlock(&node_lock);
+
+	return err;
+}
+
+int nodes_next(int prev)
+{
+	int err = -ENOENT;
+
+	// no lock: in_use is a single bool, worst case we visit a node removed a moment ago
+	for (int i = 1; i <= NODES_MAX; i++)
+	{
+		int id = (prev + i + NODES_MAX) % NODES_MAX;
+
+		if (!node_table[id].in_use)
+		{
+			continue;
+		}
+
+		if (!nodes_due(id))
+		{
+			err = -EAGAIN; // there is a node, just not one worth a slot right now
+			continue;
+		}
+
+		return id;
+	}
+
+	return err;
+}
+
+bool nodes_due(int id)
+{
+	if (id < 0 || id >= NODES_MAX || !node_table[id].in_use)
+	{
+		return false;
+	}
+
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key = k_spin_lock(&liveness_lock);
+	bool due = !node_table[id].liveness.absent || now >= node_table[id].next_poll_ms;
+
+	k_spin_unlock(&liveness_lock, key);
+	return due;
+}
+
+void nodes_on_poll_result(int id, bool success)
+{
+	if (id < 0 || id >= NODES_MAX)
+	{
+		return;
+	}
+
+	struct node *node = &node_table[id];
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key = k_spin_lock(&liveness_lock);
+
+	if (success)
+	{
+		// back in every round right away
+		node->liveness.absent = false;
+		node->liveness.failures = 0;
+		node->liveness.backoff_ms = 0;
+		node->liveness.last_seen_ms = now;
+	}
+	else if (node->liveness.absent)
+	{
+		node->liveness.backoff_ms = MIN(node->liveness.backoff_ms * 2, CONFIG_ESB_PTX_BACKOFF_MAX_MS);
+		node->next_poll_ms = now + node->liveness.backoff_ms;
+	}
+	else if (++node->liveness.failures >= CONFIG_ESB_PTX_ABSENT_AFTER_FAILURES)
+	{
+		node->liveness.absent = true;
+		node->liveness.backoff_ms = CONFIG_ESB_PTX_BACKOFF_MIN_MS;
+		node->next_poll_ms = now + node->liveness.backoff_ms;
+	}
+	k_spin_unlock(&liveness_lock, key);
+}
+
+int nodes_get_liveness(int id, struct node_liveness *liveness)
+{
+	if (id < 0 || id >= NODES_MAX)
+	{
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&liveness_lock);
+	*liveness = node_table[id].liveness;
+	k_spin_unlock(&liveness_lock, key);
+
+	return node_table[id].in_use ? 0 : -ENOENT;
+}
+
+int nodes_count(void)
+{
+	int count = 0;
+
+	for (int i = 0; i < NODES_MAX; i++)
+	{
+		count += node_table[i].in_use;
+	}
+
+	return count;
+}
+
+// default table entries come from Kconfig/esb_common.c, a bad one is a config error worth a log line
+static void nodes_seed(const struct node_cfg *cfg)
+{
+	int id = nodes_add(cfg);
+
+	if (id < 0)
+	{
+		LOG_ERR("Default node pipe %u ch %u not added, err %d", cfg->pipe, cfg->channel, id);
+	}
+}
+
+static int nodes_init(void)
+{
+	struct node_cfg cfg;
+
+	// default table, so the sample still runs without touching the shell
+#if defined(CONFIG_ESB_PTX_SHARED_CHANNEL)
+	memcpy(cfg.base_addr_0, esb_common_base_addr_0[0], sizeof(cfg.base_addr_0));
+	cfg.channel = CONFIG_ESB_PTX_SHARED_RF_CHANNEL;
+	cfg.bitrate = ESB_BITRATE_2MBPS;
+	for (int i = 0; i < CONFIG_ESB_PTX_NUM_PRX; i++)
+	{
+		cfg.pipe = i;
+		nodes_seed(&cfg);
+	}
+#else
+	cfg.pipe = 0;
+	cfg.bitrate = ESB_BITRATE_2MBPS;
+	for (int i = 0; i < ESB_COMMON_NUM_ADDR_SETS; i++)
+	{
+		memcpy(cfg.base_addr_0, esb_common_base_addr_0[i], sizeof(cfg.base_addr_0));
+		cfg.channel = esb_common_channels[i];
+		nodes_seed(&cfg);
+	}
+#endif
+
+	return 0;
+}
+
+SYS_INIT(nodes_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#if defined(CONFIG_SHELL)
+static int cmd_node_add(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t pipe = strtoul(argv[1], NULL, 0);
+	uint32_t channel = strtoul(argv[2], NULL, 0);
+	struct node_cfg cfg = {
+		.pipe = MIN(pipe, UINT8_MAX),
+		.channel = MIN(channel, UINT8_MAX),
+		.bitrate = ESB_BITRATE_2MBPS,
+	};
+
+	if (pipe >= ESB_COMMON_NUM_PIPES)
+	{
+		shell_error(sh, "pipe must be 0..%d", ESB_COMMON_NUM_PIPES - 1);
+		return -EINVAL;
+	}
+
+	if (channel > ESB_COMMON_MAX_RF_CHANNEL)
+	{
+		shell_error(sh, "channel must be 0..%d", ESB_COMMON_MAX_RF_CHANNEL);
+		return -EINVAL;
+	}
+
+	memcpy(cfg.base_addr_0, esb_common_base_addr_0[0], sizeof(cfg.base_addr_0));
+
+	if (argc > 3 && strtoul(argv[3], NULL, 0) == 1)
+	{
+		cfg.bitrate = ESB_BITRATE_1MBPS;
+	}
+
+	if (argc > 4 && hex2bin(argv[4], strlen(argv[4]), cfg.base_addr_0, sizeof(cfg.base_addr_0)) != sizeof(cfg.base_addr_0))
+	{
+		shell_error(sh, "addr must be 4 bytes of hex, e.g. e7e7e7e7");
+		return -EINVAL;
+	}
+
+	int id = nodes_add(&cfg);
+	if (id < 0)
+	{
+		shell_error(sh, "add failed, err %d", id);
+		return id;
+	}
+
+	shell_print(sh, "node %d: pipe %d ch %d", id, cfg.pipe, cfg.channel);
+	return 0;
+}
+
+static int cmd_node_rm(const struct shell *sh, size_t argc, char **argv)
+{
+	int err = nodes_remove(strtol(argv[1], NULL, 0));
+
+	if (err)
+	{
+		shell_error(sh, "remove failed, err %d", err);
+	}
+
+	return err;
+}
+
+static int cmd_node_list(const struct shell *sh, size_t argc, char **argv)
+{
+	struct node_cfg cfg;
+	struct node_liveness liveness;
+	int64_t now = k_uptime_get();
+
+	for (int i = 0; i < NODES_MAX; i++)
+	{
+		if (nodes_get_cfg(i, &cfg) == 0 && nodes_get_liveness(i, &liveness) == 0)
+		{
+			shell_print(sh, "node %2d: pipe %d ch %3d %s addr %02x%02x%02x%02x %s, last seen %lld ms ago", i,
+						cfg.pipe, cfg.channel, cfg.bitrate == ESB_BITRATE_1MBPS ? "1M" : "2M",
+						cfg.base_addr_0[0], cfg.base_addr_0[1], cfg.base_addr_0[2], cfg.base_addr_0[3],
+						liveness.absent ? "absent" : "alive", liveness.last_seen_ms ? now - liveness.last_seen_ms : -1LL);
+		}
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(node_cmds,
+							   SHELL_CMD_ARG(add, NULL, "<pipe> <channel> [bitrate 1|2 Mbps] [base addr 0 hex]", cmd_node_add, 3, 2),
+							   SHELL_CMD_ARG(rm, NULL, "<node id>", cmd_node_rm, 2, 0),
+							   SHELL_CMD_ARG(list, NULL, "list nodes", cmd_node_list, 1, 0),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(node, &node_cmds, "ESB node table", NULL);
+#endif
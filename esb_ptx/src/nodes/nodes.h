@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef NODES_H_
+#define NODES_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <esb.h>
+
+// Runtime table of the PRXs this PTX polls. Sized by CONFIG_ESB_PTX_MAX_NODES.
+#define NODES_MAX CONFIG_ESB_PTX_MAX_NODES
+
+struct node_cfg
+{
+	uint8_t base_addr_0[4]; // only on air for pipe 0, pipes 1-7 use the common base addr 1
+	uint8_t pipe;
+	uint8_t channel;
+	enum esb_bitrate bitrate;
+};
+
+// add a node, returns its id (>= 0) or -EINVAL (pipe, channel > 100)/-EEXIST/-ENOMEM
+int nodes_add(const struct node_cfg *cfg);
+int nodes_remove(int id);
+
+// copy out a node's config, -ENOENT if the slot is free
+int nodes_get_cfg(int id, struct node_cfg *cfg);
+// the node moved (channel hopping)
+int nodes_set_channel(int id, uint8_t channel);
+
+// next used id after prev that is due for a poll (wraps around, pass -1 to start).
+// -ENOENT when the table is empty, -EAGAIN when every node is absent and backing off.
+int nodes_next(int prev);
+// used and not an absent node waiting out its backoff
+bool nodes_due(int id);
+int nodes_count(void);
+
+/* Liveness. CONFIG_ESB_PTX_ABSENT_AFTER_FAILURES failed polls in a row mark a node absent,
+ * it is then only polled every backoff interval (doubling from CONFIG_ESB_PTX_BACKOFF_MIN_MS
+ * up to CONFIG_ESB_PTX_BACKOFF_MAX_MS). One answered poll and it is back in every round.
+ */
+struct node_liveness
+{
+	bool absent;
+	uint16_t failures; // in a row
+	int64_t last_seen_ms; // uptime of the last answered poll, 0 = never
+	uint32_t backoff_ms;
+};
+
+// esb callback side
+void nodes_on_poll_result(int id, bool success);
+int nodes_get_liveness(int id, struct node_liveness *liveness);
+
+// true if node can be polled from the esb session set up for radio by only changing the pipe
+bool nodes_same_radio(const struct node_cfg *node, const struct node_cfg *radio);
+
+#endif /* NODES_H_ */
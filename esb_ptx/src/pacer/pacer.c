@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <zephyr/irq.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+#include <esb.h>
+#include <hal/nrf_radio.h>
+#include <hal/nrf_timer.h>
+#include <helpers/nrfx_gppi.h>
+
+#include "pacer.h"
+
+LOG_MODULE_REGISTER(pacer);
+
+// TIMER2 belongs to esb, there is no MPSL on the ptx so TIMER1 is free
+#define PACER_TIMER NRF_TIMER1
+#define PACER_IRQn TIMER1_IRQn
+#define TICKS_PER_US 16 // prescaler 0
+#define NO_CAPTURE UINT32_MAX
+
+static uint8_t capture_ch;
+static nrfx_gppi_channel_group_t capture_group;
+static bool ppi_ready;
+static volatile bool held;
+
+// tick isr and esb callback, same priority so they don't preempt each other
+static uint32_t ticks;
+static uint32_t not_ready;
+static uint32_t busy;
+static uint32_t samples;
+static uint32_t min_cc = UINT32_MAX;
+static uint32_t max_cc;
+static uint64_t sum_cc;
+
+static void pacer_isr(const void *arg)
+{
+	ARG_UNUSED(arg);
+
+	nrf_timer_event_clear(PACER_TIMER, NRF_TIMER_EVENT_COMPARE0);
+	ticks++;
+
+	if (held)
+	{
+		not_ready++;
+		return;
+	}
+
+	// the group disables itself on the first address event, the ack's address doesn't overwrite it
+	nrf_timer_cc_set(PACER_TIMER, NRF_TIMER_CC_CHANNEL1, NO_CAPTURE);
+	nrfx_gppi_group_enable(capture_group);
+
+	int err = esb_start_tx();
+	if (err)
+	{
+		nrfx_gppi_group_disable(capture_group); // a retransmit in progress would count against this tick
+		if (err == -EBUSY)
+		{
+			busy++;
+		}
+		else
+		{
+			not_ready++;
+		}
+	}
+}
+
+static int pacer_ppi_setup(void)
+{
+	uint32_t address_evt = nrf_radio_event_address_get(NRF_RADIO, NRF_RADIO_EVENT_ADDRESS);
+	uint32_t capture_task = nrf_timer_task_address_get(PACER_TIMER, NRF_TIMER_TASK_CAPTURE1);
+
+	if (nrfx_gppi_channel_alloc(&capture_ch) != NRFX_SUCCESS ||
+		nrfx_gppi_group_alloc(&capture_group) != NRFX_SUCCESS)
+	{
+		return -ENOMEM;
+	}
+
+	nrfx_gppi_channel_endpoints_setup(capture_ch, address_evt, capture_task);
+	nrfx_gppi_fork_endpoint_setup(capture_ch,
+								  nrfx_gppi_task_address_get(nrfx_gppi_group_disable_task_get(capture_group)));
+	nrfx_gppi_channels_include_in_group(BIT(capture_ch), capture_group);
+
+	return 0;
+}
+
+int pacer_start(uint32_t period_us)
+{
+	if (period_us == 0 || period_us > UINT32_MAX / TICKS_PER_US)
+	{
+		return -EINVAL;
+	}
+
+	if (!ppi_ready)
+	{
+		int err = pacer_ppi_setup();
+		if (err)
+		{
+			return err;
+		}
+
+		// same priority as the esb callback, which writes the txn pickups into the fifo
+		IRQ_CONNECT(PACER_IRQn, CONFIG_ESB_EVENT_IRQ_PRIORITY, pacer_isr, NULL, 0);
+		irq_enable(PACER_IRQn);
+		ppi_ready = true;
+	}
+
+	nrf_timer_task_trigger(PACER_TIMER, NRF_TIMER_TASK_STOP);
+	nrf_timer_task_trigger(PACER_TIMER, NRF_TIMER_TASK_CLEAR);
+	nrf_timer_mode_set(PACER_TIMER, NRF_TIMER_MODE_TIMER);
+	nrf_timer_bit_width_set(PACER_TIMER, NRF_TIMER_BIT_WIDTH_32);
+	nrf_timer_prescaler_set(PACER_TIMER, 0);
+	nrf_timer_cc_set(PACER_TIMER, NRF_TIMER_CC_CHANNEL0, period_us * TICKS_PER_US);
+	nrf_timer_cc_set(PACER_TIMER, NRF_TIMER_CC_CHANNEL1, NO_CAPTURE);
+	nrf_timer_shorts_enable(PACER_TIMER, NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK);
+	nrf_timer_event_clear(PACER_TIMER, NRF_TIMER_EVENT_COMPARE0);
+	nrf_timer_int_enable(PACER_TIMER, NRF_TIMER_INT_COMPARE0_MASK);
+	held = false;
+	nrf_timer_task_trigger(PACER_TIMER, NRF_TIMER_TASK_START);
+
+	LOG_INF("Polling every %u us", period_us);
+	return 0;
+}
+
+void pacer_stop(void)
+{
+	nrf_timer_int_disable(PACER_TIMER, NRF_TIMER_INT_COMPARE0_MASK);
+	nrf_timer_task_trigger(PACER_TIMER, NRF_TIMER_TASK_STOP);
+	if (ppi_ready)
+	{
+		nrfx_gppi_group_disable(capture_group);
+	}
+}
+
+void pacer_hold(bool hold)
+{
+	held = hold;
+}
+
+void pacer_on_tx_result(uint32_t tx_attempts)
+{
+	uint32_t cc = nrf_timer_cc_get(PACER_TIMER, NRF_TIMER_CC_CHANNEL1);
+
+	// a retransmit's address isn't the one the tick started
+	if (tx_attempts != 1 || cc == NO_CAPTURE)
+	{
+		return;
+	}
+
+	samples++;
+	sum_cc += cc;
+	min_cc = MIN(min_cc, cc);
+	max_cc = MAX(max_cc, cc);
+}
+
+static uint32_t cc_to_ns(uint64_t cc)
+{
+	return (uint32_t)(cc * NSEC_PER_USEC / TICKS_PER_US);
+}
+
+void pacer_stats_get(struct pacer_stats *stats)
+{
+	unsigned int key = irq_lock();
+
+	stats->ticks = ticks;
+	stats->not_ready = not_ready;
+	stats->busy = busy;
+	stats->samples = samples;
+	stats->min_ns = samples ? cc_to_ns(min_cc) : 0;
+	stats->avg_ns = samples ? cc_to_ns(sum_cc / samples) : 0;
+	stats->max_ns = cc_to_ns(max_cc);
+	ticks = 0;
+	not_ready = 0;
+	busy = 0;
+	samples = 0;
+	min_cc = UINT32_MAX;
+	max_cc = 0;
+	sum_cc = 0;
+	irq_unlock(key);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef PACER_H_
+#define PACER_H_
+
+#include <zephyr/types.h>
+
+/* Hardware paced polling. A TIMER compare fires every CONFIG_ESB_PTX_FIXED_RATE_PERIOD_US
+ * and its interrupt starts whatever the poll loop left in the ESB TX FIFO (ESB runs in
+ * ESB_TXMODE_MANUAL_START), so when a poll goes out no longer depends on when the loop
+ * got to run. The loop only prepares the next payload in between.
+ * ESB drives the radio tasks itself, the start can't be wired to the radio through PPI,
+ * so the tick interrupt does nothing but esb_start_tx(). A PPI channel captures the first
+ * RADIO ADDRESS event after every tick into the same TIMER, the spread of those captures
+ * is the on-air jitter.
+ */
+
+struct pacer_stats
+{
+	uint32_t ticks;
+	uint32_t not_ready; // empty esb fifo at the tick, the loop had nothing for it (or was held)
+	uint32_t busy;		// the previous poll was still retransmitting at the tick
+	uint32_t samples;	// polls through on the first attempt, only those are measured
+	uint32_t min_ns;	// tick to address on air
+	uint32_t avg_ns;
+	uint32_t max_ns;
+};
+
+int pacer_start(uint32_t period_us);
+void pacer_stop(void);
+
+// ticks are skipped while held, for esb_disable()/esb_init() from the poll loop. the timer
+// keeps running so the rate doesn't drift.
+void pacer_hold(bool hold);
+
+// esb callback, takes the capture of the poll that just finished
+void pacer_on_tx_result(uint32_t tx_attempts);
+
+// since the last call
+void pacer_stats_get(struct pacer_stats *stats);
+
+#endif /* PACER_H_ */
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <stdlib.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+#include "nodes/nodes.h"
+#include "retx.h"
+
+LOG_MODULE_REGISTER(retx);
+
+#define LOSS_ONE BIT(16)   // loss is Q16, LOSS_ONE = every attempt lost
+#define LOSS_EWMA_SHIFT 4 // each attempt moves the average 1/16 of the way
+#define TARGET_LOSS (LOSS_ONE * CONFIG_ESB_PTX_RETX_TARGET_LOSS_PERMILLE / 1000)
+
+static uint32_t node_loss[NODES_MAX]; // esb irq context writes, poll loop reads
+
+static void loss_update(uint32_t *loss, bool lost)
+{
+	uint32_t sample = lost ? LOSS_ONE : 0;
+
+	*loss = *loss - (*loss >> LOSS_EWMA_SHIFT) + (sample >> LOSS_EWMA_SHIFT);
+}
+
+void retx_on_tx_result(int node, bool success, uint32_t attempts)
+{
+	if (node < 0 || node >= NODES_MAX)
+	{
+		return;
+	}
+
+	// a success on attempt n still says n - 1 attempts got lost
+	uint32_t lost = success ? MAX(attempts, 1) - 1 : MAX(attempts, 1);
+
+	for (uint32_t i = 0; i < lost; i++)
+	{
+		loss_update(&node_loss[node], true);
+	}
+	if (success)
+	{
+		loss_update(&node_loss[node], false);
+	}
+}
+
+void retx_get(int node, enum esb_bitrate bitrate, struct retx_policy *policy)
+{
+	uint32_t loss = (node >= 0 && node < NODES_MAX) ? node_loss[node] : 0;
+	uint32_t residual = loss;
+	uint16_t delay_min = CONFIG_ESB_PTX_RETX_DELAY_MIN_US;
+
+	policy->count = 0;
+	while (residual > TARGET_LOSS && policy->count < CONFIG_ESB_PTX_RETX_MAX_COUNT)
+	{
+		residual = ((uint64_t)residual * loss) >> 16;
+		policy->count++;
+	}
+
+	// twice the air time for the packet and its ack payload at 1 Mbps
+	if (bitrate == ESB_BITRATE_1MBPS)
+	{
+		delay_min *= 2;
+	}
+	// spread on top of the minimum, so a large payload minimum can't end up above the lossy delay
+	policy->delay_us = delay_min + ((uint64_t)CONFIG_ESB_PTX_RETX_DELAY_MAX_US * loss >> 16);
+}
+
+void retx_reset(int node)
+{
+	if (node >= 0 && node < NODES_MAX)
+	{
+		node_loss[node] = 0;
+	}
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_retx(const struct shell *sh, size_t argc, char **argv)
+{
+	struct node_cfg cfg;
+	struct retx_policy policy;
+
+	for (int i = 0; i < NODES_MAX; i++)
+	{
+		if (nodes_get_cfg(i, &cfg) == 0)
+		{
+			retx_get(i, cfg.bitrate, &policy);
+			shell_print(sh, "node %2d: loss %3u.%u%% retransmits %u delay %u us", i,
+						(uint32_t)(node_loss[i] * 100ULL >> 16), (uint32_t)((node_loss[i] * 1000ULL >> 16) % 10),
+						policy.count, policy.delay_us);
+		}
+	}
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(retx, NULL, "per node attempt loss and retransmit policy", cmd_retx);
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef RETX_H_
+#define RETX_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* Per-node retransmit policy. Each node keeps an EWMA of its per-attempt loss and gets
+ * the fewest retransmits that bring the residual loss under
+ * CONFIG_ESB_PTX_RETX_TARGET_LOSS_PERMILLE, so healthy nodes poll with no retries at all.
+ * The delay between retries grows with the loss (CONFIG_ESB_PTX_RETX_DELAY_MAX_US on top of
+ * the minimum at 100%), lossy links tend to be bursty.
+ */
+
+struct retx_policy
+{
+	uint8_t count;
+	uint16_t delay_us;
+};
+
+// esb callback side, attempts is esb_evt.tx_attempts
+void retx_on_tx_result(int node, bool success, uint32_t attempts);
+
+// what to poll this node with
+void retx_get(int node, enum esb_bitrate bitrate, struct retx_policy *policy);
+
+// forget the history, node id got (re)assigned
+void retx_reset(int node);
+
+#endif /* RETX_H_ */
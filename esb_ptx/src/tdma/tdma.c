@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "esb_proto.h"
+#include "nodes/nodes.h"
+#include "tdma.h"
+
+LOG_MODULE_REGISTER(tdma);
+
+#define CYCLE_US CONFIG_ESB_PTX_TDMA_CYCLE_US
+#define SLOT_US CONFIG_ESB_PTX_TDMA_SLOT_US
+#define SLOTS MIN(CYCLE_US / SLOT_US, NODES_MAX)
+
+BUILD_ASSERT(CONFIG_ESB_PTX_TDMA_SLOT_US <= CONFIG_ESB_PTX_TDMA_CYCLE_US, "need at least one slot per cycle");
+
+static int64_t cycle_start_ticks = -1;
+static int slot = -1;
+static uint32_t cycle;
+static uint32_t overruns;
+
+int tdma_next(int64_t *slot_ticks)
+{
+	int64_t now = k_uptime_ticks();
+
+	if (cycle_start_ticks < 0)
+	{
+		cycle_start_ticks = now;
+	}
+
+	// at most one full cycle of empty slots to skip
+	for (int i = 0; i < SLOTS; i++)
+	{
+		struct node_cfg cfg;
+
+		if (++slot >= SLOTS)
+		{
+			slot = 0;
+			cycle++;
+			cycle_start_ticks += k_us_to_ticks_near64(CYCLE_US);
+		}
+
+		if (nodes_get_cfg(slot, &cfg) == 0)
+		{
+			*slot_ticks = cycle_start_ticks + k_us_to_ticks_near64((uint64_t)slot * SLOT_US);
+			if (now - *slot_ticks > k_us_to_ticks_near64(SLOT_US))
+			{
+				// fell behind, restart the schedule from here instead of rushing through the missed slots
+				overruns++;
+				cycle_start_ticks = now - k_us_to_ticks_near64((uint64_t)slot * SLOT_US);
+				*slot_ticks = now;
+			}
+			return slot;
+		}
+	}
+
+	return -ENOENT;
+}
+
+bool tdma_build_sync(int node, struct esb_payload *payload, uint32_t late_us)
+{
+	struct esb_proto_hdr *hdr = (struct esb_proto_hdr *)payload->data;
+	struct esb_proto_sync *sync = (struct esb_proto_sync *)&payload->data[ESB_PROTO_HDR_LEN];
+
+	if (cycle % CONFIG_ESB_PTX_TDMA_SYNC_EVERY != 0)
+	{
+		return false;
+	}
+
+	hdr->type = ESB_PROTO_SYNC;
+	hdr->id = (uint8_t)node;
+	sync->cycle_us = sys_cpu_to_le32(CYCLE_US);
+	sync->late_us = sys_cpu_to_le32(late_us);
+	payload->length = ESB_PROTO_HDR_LEN + sizeof(*sync);
+
+	return true;
+}
+
+uint32_t tdma_overruns(void)
+{
+	return overruns;
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef TDMA_H_
+#define TDMA_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* Fixed poll schedule. Every CONFIG_ESB_PTX_TDMA_CYCLE_US node id n gets polled at
+ * n * CONFIG_ESB_PTX_TDMA_SLOT_US into the cycle, free ids leave their slot empty. Every
+ * CONFIG_ESB_PTX_TDMA_SYNC_EVERY cycles a node's poll is an ESB_PROTO_SYNC with the cycle
+ * length and how late the poll went out, the PRX times its sampling off that.
+ */
+
+// poll loop: next node in the schedule and the k_uptime_ticks() its slot starts at.
+// -ENOENT if no node fits in the cycle.
+int tdma_next(int64_t *slot_ticks);
+
+// turns the node's poll into a sync frame if one is due, false to poll as usual
+bool tdma_build_sync(int node, struct esb_payload *payload, uint32_t late_us);
+
+// slots the loop got to more than a slot late (slot taken by a transaction, bulk, logging)
+uint32_t tdma_overruns(void);
+
+#endif /* TDMA_H_ */
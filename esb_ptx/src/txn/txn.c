@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/timing/timing.h>
+
+#include "esb_proto.h"
+#include "txn.h"
+
+LOG_MODULE_REGISTER(txn);
+
+enum txn_state
+{
+	TXN_IDLE,
+	TXN_QUEUED,		 // waiting for the poll loop to hand over the radio
+	TXN_REQ_SENT,	 // request on air
+	TXN_PICKUP_SENT, // pickup on air, the response comes back in its ack payload
+};
+
+static volatile enum txn_state state = TXN_IDLE;
+static K_MUTEX_DEFINE(txn_lock); // one caller at a time
+static K_SEM_DEFINE(txn_done_sem, 0, 1);
+
+static struct esb_payload req_payload;
+static struct esb_payload pickup_payload;
+static uint8_t txn_id; // of the caller waiting in txn_request()
+static uint8_t sent_id; // of the request/pickups on air
+static int txn_node;
+static uint8_t pickups;
+
+// filled in by the esb callback
+static int txn_result;
+static uint8_t rsp_buf[ESB_PROTO_MAX_BODY_LEN];
+static timing_t start_time;
+static uint64_t latency_cyc;
+
+// esb irq context or irq locked. a transaction that timed out, or was replaced by a newer one, finishes quietly.
+static void txn_finish(uint8_t id, int result)
+{
+	if (state == TXN_IDLE || id != txn_id)
+	{
+		return;
+	}
+	txn_result = result;
+	state = TXN_IDLE;
+	k_sem_give(&txn_done_sem);
+}
+
+static bool txn_send_pickup(void)
+{
+	esb_flush_tx(); // a failed pickup stays in the fifo
+	state = TXN_PICKUP_SENT;
+	pickups++;
+
+	int err = esb_write_payload(&pickup_payload);
+	if (err)
+	{
+		txn_finish(sent_id, err);
+		return false;
+	}
+
+	return true;
+}
+
+bool txn_on_tx_success(const struct esb_payload *ack)
+{
+	const struct esb_proto_hdr *hdr;
+
+	switch (state)
+	{
+	case TXN_REQ_SENT:
+		return txn_send_pickup(); // node is building the response while this ramps up
+
+	case TXN_PICKUP_SENT:
+		hdr = ack ? (const struct esb_proto_hdr *)ack->data : NULL;
+		if (hdr && ack->length >= ESB_PROTO_HDR_LEN && hdr->type == ESB_PROTO_TXN_RSP && hdr->id == sent_id)
+		{
+			timing_t end_time = timing_counter_get();
+			uint8_t len = ack->length - ESB_PROTO_HDR_LEN;
+
+			latency_cyc = timing_cycles_get(&start_time, &end_time);
+			memcpy(rsp_buf, &ack->data[ESB_PROTO_HDR_LEN], len);
+			txn_finish(sent_id, len);
+			return false;
+		}
+
+		// node wasn't done yet (or acked with old data), ask again
+		if (pickups <= CONFIG_ESB_PTX_TXN_PICKUP_RETRIES)
+		{
+			return txn_send_pickup();
+		}
+
+		txn_finish(sent_id, -EAGAIN);
+		return false;
+
+	default:
+		return false;
+	}
+}
+
+bool txn_on_tx_failed(void)
+{
+	switch (state)
+	{
+	case TXN_REQ_SENT:
+		txn_finish(sent_id, -EIO);
+		return false;
+
+	case TXN_PICKUP_SENT:
+		if (pickups <= CONFIG_ESB_PTX_TXN_PICKUP_RETRIES)
+		{
+			return txn_send_pickup();
+		}
+
+		txn_finish(sent_id, -EIO);
+		return false;
+
+	default:
+		return false;
+	}
+}
+
+int txn_pending_node(uint8_t *id)
+{
+	unsigned int key = irq_lock();
+	int node = -1;
+
+	if (state == TXN_QUEUED)
+	{
+		node = txn_node;
+		*id = txn_id;
+	}
+	irq_unlock(key);
+
+	return node;
+}
+
+int txn_send_request(uint8_t id, uint8_t pipe)
+{
+	unsigned int key = irq_lock();
+	int err;
+
+	// the caller may have timed out (and queued the next one) since txn_pending_node()
+	if (state != TXN_QUEUED || id != txn_id)
+	{
+		irq_unlock(key);
+		return -ECANCELED;
+	}
+
+	req_payload.pipe = pipe;
+	pickup_payload.pipe = pipe;
+	pickups = 0;
+	sent_id = id;
+	start_time = timing_counter_get();
+	state = TXN_REQ_SENT; // before the write, the tx event can beat us back here
+
+	err = esb_write_payload(&req_payload);
+	if (err)
+	{
+		txn_finish(id, err);
+	}
+	irq_unlock(key);
+
+	return err;
+}
+
+void txn_cancel(uint8_t id, int err)
+{
+	unsigned int key = irq_lock();
+
+	txn_finish(id, err);
+	irq_unlock(key);
+}
+
+void txn_abort(int err)
+{
+	unsigned int key = irq_lock();
+
+	txn_finish(txn_id, err);
+	irq_unlock(key);
+}
+
+int txn_request(int node_id, const uint8_t *req, uint8_t req_len, uint8_t *rsp, uint8_t rsp_max,
+				uint32_t *latency_us, k_timeout_t timeout)
+{
+	struct esb_proto_hdr *hdr;
+	int result;
+
+	if (req_len > ESB_PROTO_MAX_BODY_LEN)
+	{
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&txn_lock, K_FOREVER);
+
+	txn_id++;
+	hdr = (struct esb_proto_hdr *)req_payload.data;
+	hdr->type = ESB_PROTO_TXN_REQ;
+	hdr->id = txn_id;
+	memcpy(&req_payload.data[ESB_PROTO_HDR_LEN], req, req_len);
+	req_payload.length = ESB_PROTO_HDR_LEN + req_len;
+	req_payload.noack = false;
+
+	hdr = (struct esb_proto_hdr *)pickup_payload.data;
+	hdr->type = ESB_PROTO_TXN_PICKUP;
+	hdr->id = txn_id;
+	pickup_payload.length = ESB_PROTO_HDR_LEN;
+	pickup_payload.noack = false;
+
+	txn_node = node_id;
+	k_sem_reset(&txn_done_sem);
+
+	unsigned int key = irq_lock();
+
+	state = TXN_QUEUED;
+	irq_unlock(key);
+
+	if (k_sem_take(&txn_done_sem, timeout))
+	{
+		// whatever is on air now finishes on its own, the callback sees idle and lets the poll loop go
+		key = irq_lock();
+		bool finished = state == TXN_IDLE && k_sem_count_get(&txn_done_sem);
+
+		state = TXN_IDLE;
+		irq_unlock(key);
+
+		if (!finished)
+		{
+			k_mutex_unlock(&txn_lock);
+			return -ETIMEDOUT;
+		}
+	}
+
+	result = txn_result;
+	if (result >= 0)
+	{
+		result = MIN(result, rsp_max);
+		memcpy(rsp, rsp_buf, result);
+		if (latency_us)
+		{
+			*latency_us = (uint32_t)(timing_cycles_to_ns(latency_cyc) / NSEC_PER_USEC);
+		}
+	}
+
+	k_mutex_unlock(&txn_lock);
+	return result;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_txn(const struct shell *sh, size_t argc, char **argv)
+{
+	uint8_t req[ESB_PROTO_MAX_BODY_LEN];
+	uint8_t rsp[ESB_PROTO_MAX_BODY_LEN];
+	uint32_t latency_us = 0;
+	size_t req_len = hex2bin(argv[2], strlen(argv[2]), req, sizeof(req));
+
+	if (req_len == 0)
+	{
+		shell_error(sh, "request must be hex, e.g. 0102a0");
+		return -EINVAL;
+	}
+
+	int len = txn_request(strtol(argv[1], NULL, 0), req, req_len, rsp, sizeof(rsp), &latency_us, K_MSEC(100));
+	if (len < 0)
+	{
+		shell_error(sh, "transaction failed, err %d", len);
+		return len;
+	}
+
+	shell_hexdump(sh, rsp, len);
+	shell_print(sh, "%d bytes in %u us", len, latency_us);
+	return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(txn, NULL, "<node id> <request hex>, send a request and wait for the response", cmd_txn, 3, 0);
+#endif
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef TXN_H_
+#define TXN_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <esb.h>
+
+/* Request/response transactions. The request and the pickup that collects the response
+ * go out back to back from the esb callback, so the response doesn't wait for the node's
+ * next round-robin poll.
+ */
+
+// blocking, one transaction at a time. returns the response length, or -ETIMEDOUT, -EIO (tx failed),
+// -EAGAIN (node never had the response ready). latency_us (optional) is request on air -> response in.
+int txn_request(int node_id, const uint8_t *req, uint8_t req_len, uint8_t *rsp, uint8_t rsp_max,
+				uint32_t *latency_us, k_timeout_t timeout);
+
+// poll loop side. node with a request waiting for the radio and its id, -1 if none.
+int txn_pending_node(uint8_t *id);
+// put the pending request on air, the rest happens in the esb callback. -ECANCELED (nothing sent)
+// when transaction id is no longer the one waiting.
+int txn_send_request(uint8_t id, uint8_t pipe);
+// fail transaction id if it is still the one waiting
+void txn_cancel(uint8_t id, int err);
+// fail whatever transaction is waiting or on air
+void txn_abort(int err);
+
+// esb callback side. true when the transaction put another packet on air, the radio is still busy.
+bool txn_on_tx_success(const struct esb_payload *ack);
+bool txn_on_tx_failed(void);
+
+#endif /* TXN_H_ */
@@ -0,0 +1,35 @@
+#!/usr/bin/env bash
+# Copyright (c) 2024 Nordic Semiconductor ASA
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+# Builds the images for run_bench.sh: one ptx per node count and one prx per pipe.
+# Needs ZEPHYR_BASE and BSIM_OUT_PATH / BSIM_COMPONENTS_PATH set up as for the
+# zephyr bsim tests. Images end up in ${BSIM_OUT_PATH}/bin/bs_nrf52_bsim_esb_*.
+set -e
+
+: "${ZEPHYR_BASE:?ZEPHYR_BASE must be set}"
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be set}"
+
+REPO_ROOT=$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)
+BUILD_DIR=${BUILD_DIR:-${REPO_ROOT}/build_bsim}
+NODE_COUNTS=${NODE_COUNTS:-"1 2 4 8"}
+BOARD=nrf52_bsim
+
+function build_image() {
+	local app=$1 name=$2
+	shift 2
+
+	west build -p auto -b ${BOARD} -d "${BUILD_DIR}/${name}" "${REPO_ROOT}/${app}" -- "$@"
+	cp "${BUILD_DIR}/${name}/zephyr/zephyr.exe" "${BSIM_OUT_PATH}/bin/bs_${BOARD}_esb_${name}"
+}
+
+# 8 nodes need pipe 7, keep it out of broadcast use whatever the app defaults say
+max_nodes=0
+for n in ${NODE_COUNTS}; do
+	build_image esb_ptx ptx_n${n} -DCONFIG_ESB_PTX_NUM_PRX=${n} -DCONFIG_ESB_PTX_BCAST=n
+	max_nodes=$(( n > max_nodes ? n : max_nodes ))
+done
+
+for (( pipe = 0; pipe < max_nodes; pipe++ )); do
+	build_image esb_prx_blefallback prx_${pipe} -DCONFIG_ESB_PRX_PERIPHERAL_NUMBER=${pipe} -DCONFIG_ESB_PRX_BCAST=n
+done
@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+# Copyright (c) 2024 Nordic Semiconductor ASA
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+# Runs the ptx against N simulated prxs for each node count and prints the
+# "bench:" summary the ptx logs (CONFIG_ESB_PTX_BENCH_DURATION_MS, see
+# esb_ptx/boards/nrf52_bsim.conf). Build the images with compile.sh first.
+#
+#   NODE_COUNTS="1 2 4 8" tests/bsim/run_bench.sh
+set -e
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be set}"
+
+NODE_COUNTS=${NODE_COUNTS:-"1 2 4 8"}
+SIM_LENGTH=${SIM_LENGTH:-8e6} # us of simulated time, boot + 5 s bench + margin
+LOG_DIR=${LOG_DIR:-$(pwd)/bsim_bench_logs}
+BIN=${BSIM_OUT_PATH}/bin
+BOARD=nrf52_bsim
+
+mkdir -p "${LOG_DIR}"
+status=0
+
+for n in ${NODE_COUNTS}; do
+	sim_id=esb_bench_n${n}_$$
+	pids=()
+
+	cd "${BIN}"
+	./bs_${BOARD}_esb_ptx_n${n} -s=${sim_id} -d=0 > "${LOG_DIR}/ptx_n${n}.log" 2>&1 &
+	pids+=($!)
+	for (( pipe = 0; pipe < n; pipe++ )); do
+		./bs_${BOARD}_esb_prx_${pipe} -s=${sim_id} -d=$(( pipe + 1 )) \
+			> "${LOG_DIR}/prx_${pipe}_n${n}.log" 2>&1 &
+		pids+=($!)
+	done
+	./bs_2G4_phy_v1 -s=${sim_id} -D=$(( n + 1 )) -sim_length=${SIM_LENGTH} > "${LOG_DIR}/phy_n${n}.log" 2>&1 &
+	pids+=($!)
+
+	for pid in "${pids[@]}"; do
+		wait ${pid} || status=1
+	done
+
+	echo "== ${n} node(s) =="
+	if ! grep -o "bench: .*" "${LOG_DIR}/ptx_n${n}.log"; then
+		echo "no bench summary, see ${LOG_DIR}/ptx_n${n}.log"
+		status=1
+	fi
+done
+
+exit ${status}
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+# Copyright (c) 2024 Nordic Semiconductor ASA
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+# Decodes a "trace dump" capture (CONFIG_ESB_TRACE, common/esb_trace.h) into a timeline.
+# Reads the shell output from a file or stdin, anything that isn't a trace line is skipped.
+#
+#   tools/esb_trace_decode.py uart.log
+#   tools/esb_trace_decode.py --csv < uart.log > trace.csv
+import argparse
+import re
+import struct
+import sys
+
+# struct esb_trace_record
+RECORD = struct.Struct("<IHBBBbH")
+
+# enum esb_trace_event
+EVENTS = {
+    1: "tx_write",
+    2: "tx_success",
+    3: "tx_failed",
+    4: "rx",
+    5: "ack_done",
+    6: "record",
+    7: "recover",
+    8: "bcast",
+}
+
+# enum esb_proto_type, for the events that carry it in arg
+PROTO_TYPES = {
+    1: "DATA",
+    2: "TXN_REQ",
+    3: "TXN_PICKUP",
+    4: "TXN_RSP",
+    5: "PLACEHOLDER",
+    6: "BULK_REQ",
+    7: "BULK_DATA",
+    8: "HOP",
+    9: "SYNC",
+    10: "BCAST",
+}
+
+HEADER_RE = re.compile(r"trace: (\d+) records, (\d+) MHz")
+LINE_RE = re.compile(r"trace ([0-9a-fA-F]{%d})\b" % (RECORD.size * 2))
+
+
+def parse(lines):
+    mhz = None
+    records = []
+    for line in lines:
+        m = HEADER_RE.search(line)
+        if m:
+            mhz = int(m.group(2))
+            records = []  # a later dump replaces an earlier one
+            continue
+        m = LINE_RE.search(line)
+        if m:
+            records.append(RECORD.unpack(bytes.fromhex(m.group(1))))
+    return mhz, records
+
+
+def arg_text(event, arg):
+    if event in (1, 4):
+        return PROTO_TYPES.get(arg, str(arg))
+    if event in (2, 3):
+        return "attempts=%d" % arg
+    if event == 6:
+        return "0x%04x" % arg
+    if event == 8:
+        return "seq=%d" % arg
+    return ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode an ESB trace dump")
+    parser.add_argument("capture", nargs="?", type=argparse.FileType("r"), default=sys.stdin)
+    parser.add_argument("--csv", action="store_true", help="comma separated output")
+    args = parser.parse_args()
+
+    mhz, records = parse(args.capture)
+    if not records:
+        sys.exit("no trace records found")
+    if not mhz:
+        sys.exit("no 'trace:' header line, can't convert the timestamps")
+
+    sep = "," if args.csv else " "
+    print(sep.join(["seq", "time_us", "delta_us", "event", "node", "len", "rssi", "arg"]))
+
+    t = 0  # unwrapped cycles since the first record, gaps over 2^32 cycles (67 s at 64 MHz) are lost
+    prev_cycles = records[0][0]
+    prev_seq = None
+    prev_t = 0
+    for cycles, seq, event, node, length, rssi, arg in records:
+        t += (cycles - prev_cycles) & 0xFFFFFFFF
+        prev_cycles = cycles
+        if prev_seq is not None and seq != (prev_seq + 1) & 0xFFFF:
+            print("# %d records lost" % ((seq - prev_seq - 1) & 0xFFFF), file=sys.stderr)
+        prev_seq = seq
+
+        fields = [
+            str(seq),
+            "%.3f" % (t / mhz),
+            "%.3f" % ((t - prev_t) / mhz),
+            EVENTS.get(event, "event%d" % event),
+            str(node),
+            str(length),
+            str(rssi) if rssi else "",
+            arg_text(event, arg),
+        ]
+        prev_t = t
+        if args.csv:
+            print(",".join(fields))
+        else:
+            print("%6s %12s %10s %-10s %4s %4s %5s %s" % tuple(fields))
+
+
+if __name__ == "__main__":
+    main()